@@ -0,0 +1,65 @@
+// include/centideg.h — int16 centi-degree (0.01 °C) temperatures
+// - The ESP8266 has no FPU: sensor conversion, hysteresis and setpoint comparisons stay integer
+// - Range -327.67..327.67 °C covers the DS18B20 (-55..125 °C); INT16_MIN marks "no value"
+// - float only at the UI/JSON boundary (cdeg_from_c / cdeg_to_c)
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+typedef int16_t cdeg_t;
+
+static const cdeg_t CDEG_INVALID = INT16_MIN;
+
+static inline bool cdeg_valid(cdeg_t v) { return v != CDEG_INVALID; }
+
+// DS18B20 raw (1/16 °C) -> 0.01 °C, rounded half away from zero (x100/16 = x25/4)
+static inline cdeg_t cdeg_from_raw16(int16_t raw)
+{
+  int32_t v = (int32_t)raw * 25;
+  return (cdeg_t)(v >= 0 ? (v + 2) / 4 : (v - 2) / 4);
+}
+
+// UI/JSON boundary only
+static inline cdeg_t cdeg_from_c(float c)
+{
+  if (!(c > -327.0f && c < 327.0f)) // also rejects NaN
+    return CDEG_INVALID;
+  return (cdeg_t)lroundf(c * 100.0f);
+}
+
+static inline float cdeg_to_c(cdeg_t v) { return v / 100.0f; }
+
+// "-12.3" (decimals = 1, rounded) or "-12.34" (decimals = 2). Returns length; out >= 8 bytes.
+static inline size_t cdeg_format(cdeg_t v, char *out, uint8_t decimals = 1)
+{
+  int32_t a = v < 0 ? -(int32_t)v : v;
+  uint8_t scale = 100;
+  if (decimals == 1)
+  {
+    a = (a + 5) / 10; // tenths
+    scale = 10;
+  }
+  size_t n = 0;
+  if (v < 0 && a)
+    out[n++] = '-';
+  char tmp[8];
+  size_t k = 0;
+  int32_t whole = a / scale;
+  do
+  {
+    tmp[k++] = (char)('0' + whole % 10);
+    whole /= 10;
+  } while (whole);
+  while (k)
+    out[n++] = tmp[--k];
+  out[n++] = '.';
+  uint8_t frac = (uint8_t)(a % scale);
+  if (scale == 100)
+    out[n++] = (char)('0' + frac / 10);
+  out[n++] = (char)('0' + frac % 10);
+  out[n] = 0;
+  return n;
+}
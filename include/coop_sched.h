@@ -0,0 +1,140 @@
+// include/coop_sched.h — fixed-table cooperative scheduler for loop()
+// - Each task: period (0 = every pass), priority (0 = most urgent), relative deadline
+// - runPass(): runs every released task at most once, always picking the most urgent one
+//   still pending; after each run the table is re-scanned, so a task released while a slow one
+//   ran (e.g. the control tick behind a TLS call) goes next, ahead of lower priorities
+// - Releases advance on a fixed grid (release += period), so cadence does not drift with run
+//   time; releases missed entirely are skipped and counted instead of run back to back
+// - Per task: runs, last/max/avg run time (us), lateness (start - release, ms), deadline misses
+//   (finish - release > deadline), skipped releases
+// - No Arduino dependencies: the caller passes the ms/us clocks in
+
+#pragma once
+
+#include <stdint.h>
+
+struct CoopTask
+{
+  const char *name;
+  void (*fn)();
+  uint32_t periodMs;   // 0 = released again right after each run
+  uint8_t priority;    // 0 = most urgent
+  uint32_t deadlineMs; // finish within this much of the release time
+
+  CoopTask(const char *n, void (*f)(), uint32_t period, uint8_t prio, uint32_t deadline)
+      : name(n), fn(f), periodMs(period), priority(prio), deadlineMs(deadline) {}
+
+  // --- state / stats ---
+  uint32_t releaseMs = 0;
+  bool ran = false; // already ran in the current pass
+  uint32_t runs = 0;
+  uint32_t lastUs = 0;
+  uint32_t maxUs = 0;
+  uint64_t totalUs = 0;
+  uint32_t maxLateMs = 0;
+  uint64_t totalLateMs = 0;
+  uint32_t overruns = 0; // deadline misses
+  uint32_t skipped = 0;  // releases dropped because the task was a whole period behind
+};
+
+class CoopScheduler
+{
+public:
+  typedef uint32_t (*ClockFn)();
+
+  CoopScheduler(CoopTask *tasks, uint8_t count, ClockFn ms, ClockFn us)
+      : tasks_(tasks), count_(count), ms_(ms), us_(us) {}
+
+  void begin()
+  {
+    const uint32_t now = ms_();
+    for (uint8_t i = 0; i < count_; ++i)
+      tasks_[i].releaseMs = now;
+  }
+
+  // Release task i now (event-driven run ahead of its period)
+  void kick(uint8_t i)
+  {
+    if (i < count_ && (int32_t)(ms_() - tasks_[i].releaseMs) < 0)
+      tasks_[i].releaseMs = ms_();
+  }
+
+  // One loop() pass. Returns how many tasks ran.
+  uint8_t runPass()
+  {
+    const uint32_t passStart = us_();
+    for (uint8_t i = 0; i < count_; ++i)
+      tasks_[i].ran = false;
+    uint8_t n = 0;
+    for (;;)
+    {
+      const uint32_t now = ms_();
+      CoopTask *t = nullptr;
+      for (uint8_t i = 0; i < count_; ++i)
+      {
+        CoopTask &c = tasks_[i];
+        if (c.ran || (int32_t)(now - c.releaseMs) < 0)
+          continue;
+        if (!t || c.priority < t->priority)
+          t = &c;
+      }
+      if (!t)
+        break;
+      run(*t, now);
+      n++;
+    }
+    const uint32_t passUs = us_() - passStart;
+    passes_++;
+    if (passUs > maxPassUs_)
+      maxPassUs_ = passUs;
+    return n;
+  }
+
+  uint8_t count() const { return count_; }
+  const CoopTask &task(uint8_t i) const { return tasks_[i]; }
+  uint32_t passes() const { return passes_; }
+  uint32_t maxPassUs() const { return maxPassUs_; }
+
+private:
+  void run(CoopTask &t, uint32_t startMs)
+  {
+    const uint32_t late = startMs - t.releaseMs;
+    const uint32_t t0 = us_();
+    t.fn();
+    const uint32_t dt = us_() - t0;
+    const uint32_t endMs = ms_();
+
+    t.ran = true;
+    t.runs++;
+    t.lastUs = dt;
+    if (dt > t.maxUs)
+      t.maxUs = dt;
+    t.totalUs += dt;
+    if (late > t.maxLateMs)
+      t.maxLateMs = late;
+    t.totalLateMs += late;
+    if (endMs - t.releaseMs > t.deadlineMs)
+      t.overruns++;
+
+    if (!t.periodMs)
+    {
+      t.releaseMs = endMs;
+      return;
+    }
+    t.releaseMs += t.periodMs;
+    const int32_t behind = (int32_t)(endMs - t.releaseMs);
+    if (behind >= (int32_t)t.periodMs)
+    {
+      const uint32_t k = (uint32_t)behind / t.periodMs; // whole periods missed: skip, keep the grid
+      t.skipped += k;
+      t.releaseMs += k * t.periodMs;
+    }
+  }
+
+  CoopTask *tasks_;
+  uint8_t count_;
+  ClockFn ms_;
+  ClockFn us_;
+  uint32_t passes_ = 0;
+  uint32_t maxPassUs_ = 0;
+};
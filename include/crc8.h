@@ -0,0 +1,26 @@
+// include/crc8.h — Dallas/Maxim CRC-8 (poly 0x31, reflected as 0x8C, init 0)
+// - The 1-Wire ROM/scratchpad CRC, reused for the ESP-NOW frame check byte
+// - Bitwise, no table: 8 shifts per byte, no flash/RAM for a 256-byte table
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+static inline uint8_t crc8_maxim(const uint8_t *p, size_t n)
+{
+  uint8_t crc = 0;
+  while (n--)
+  {
+    uint8_t b = *p++;
+    for (uint8_t i = 0; i < 8; ++i)
+    {
+      uint8_t mix = (crc ^ b) & 0x01;
+      crc >>= 1;
+      if (mix)
+        crc ^= 0x8C;
+      b >>= 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,238 @@
+// include/ds18b20.h — lean DS18B20 driver on top of a OneWire bus
+// - Resolution and conversion time are cached when configured; polling never asks the sensor
+// - One Skip-ROM convert for the whole bus, one CRC-checked 9-byte scratchpad read per ROM
+// - CRC and disconnect (no presence / all-ones scratchpad) errors are counted
+// - Templated on the bus type: OneWire on the device, any mock with the same calls on the host
+//   (reset/select/skip/write/read/read_bit), so bus transactions per sample can be counted there
+// - ds_pick_resolution(): adaptive 9/10/12-bit choice from the distance to a switching threshold
+// - Alarm mode: per-ROM TH/TL + Alarm Search (0xEC) so only sensors past a threshold are read
+
+#pragma once
+
+#include <stdint.h>
+#include "crc8.h"
+
+static const int16_t DS_RAW_INVALID = INT16_MIN; // raw value returned on a failed read
+
+enum DsReadError : uint8_t
+{
+  DS_READ_OK = 0,
+  DS_READ_NO_PRESENCE, // reset pulse unanswered
+  DS_READ_NO_DATA,     // all-ones scratchpad: addressed sensor did not drive the bus
+  DS_READ_CRC,
+};
+
+template <typename Bus>
+class Ds18b20
+{
+public:
+  explicit Ds18b20(Bus &bus) : bus_(bus) {}
+
+  // Ask the bus whether any device runs on parasite power (Read Power Supply, Skip ROM).
+  bool begin()
+  {
+    if (!bus_.reset())
+      return false;
+    bus_.skip();
+    bus_.write(CMD_READ_POWER);
+    parasite_ = bus_.read_bit() == 0; // a parasite device pulls only the first slot low
+    return true;
+  }
+
+  // Write TH/TL + resolution (9..12 bit) to every sensor's scratchpad (Skip ROM, no EEPROM copy).
+  bool setResolution(uint8_t bits)
+  {
+    if (bits < 9)
+      bits = 9;
+    if (bits > 12)
+      bits = 12;
+    if (!bus_.reset())
+    {
+      disconnects_++;
+      return false;
+    }
+    bus_.skip();
+    bus_.write(CMD_WRITE_SCRATCH);
+    bus_.write((uint8_t)th_);
+    bus_.write((uint8_t)tl_);
+    bus_.write((uint8_t)(((bits - 9) << 5) | 0x1F));
+    bits_ = bits;
+    configGen_++; // every sensor's TH/TL were just overwritten too
+    return true;
+  }
+
+  // TH/TL of one sensor (scratchpad only, no EEPROM copy); resolution is kept.
+  bool writeAlarm(const uint8_t *rom, int8_t th, int8_t tl)
+  {
+    if (!bus_.reset())
+    {
+      disconnects_++;
+      return false;
+    }
+    bus_.select(rom);
+    bus_.write(CMD_WRITE_SCRATCH);
+    bus_.write((uint8_t)th);
+    bus_.write((uint8_t)tl);
+    bus_.write((uint8_t)(((bits_ - 9) << 5) | 0x1F));
+    alarmWrites_++;
+    return true;
+  }
+
+  // Alarm Search: calls onRom(rom) for every CRC-valid sensor whose last conversion was
+  // >= TH or <= TL. Returns how many answered (usually 0: one reset + a few slots).
+  template <typename F>
+  uint8_t alarmSearch(F onRom)
+  {
+    uint8_t rom[8];
+    uint8_t n = 0;
+    alarmSearches_++;
+    bus_.reset_search();
+    while (bus_.search(rom, false))
+    {
+      if (crc8_maxim(rom, 7) != rom[7])
+        continue;
+      onRom(rom);
+      n++;
+    }
+    alarmHits_ += n;
+    return n;
+  }
+
+  // Bumped by setResolution(): TH/TL programmed before it are gone.
+  uint16_t configGen() const { return configGen_; }
+
+  uint8_t resolution() const { return bits_; }
+
+  // 9/10/11/12-bit => ~94/188/375/750 ms (datasheet max tCONV)
+  uint16_t conversionMs() const
+  {
+    static const uint16_t TCONV[4] = {94, 188, 375, 750};
+    return TCONV[bits_ - 9];
+  }
+
+  // Start a conversion on every sensor at once.
+  bool convertAll()
+  {
+    if (!bus_.reset())
+    {
+      disconnects_++;
+      return false;
+    }
+    bus_.skip();
+    bus_.write(CMD_CONVERT, parasite_ ? 1 : 0); // strong pull-up held until the next reset
+    conversions_++;
+    return true;
+  }
+
+  // Scratchpad of one sensor -> raw 1/16 °C (undefined low bits cleared for the resolution).
+  // DS_RAW_INVALID on missing presence pulse, all-ones scratchpad or CRC mismatch.
+  int16_t readRaw(const uint8_t *rom)
+  {
+    reads_++;
+    if (!bus_.reset())
+    {
+      disconnects_++;
+      lastError_ = DS_READ_NO_PRESENCE;
+      return DS_RAW_INVALID;
+    }
+    bus_.select(rom);
+    bus_.write(CMD_READ_SCRATCH);
+    uint8_t sp[9];
+    uint8_t all = 0xFF;
+    for (uint8_t i = 0; i < 9; ++i)
+    {
+      sp[i] = bus_.read();
+      all &= sp[i];
+    }
+    if (all == 0xFF)
+    {
+      disconnects_++; // nobody drove the bus: sensor gone mid-transaction
+      lastError_ = DS_READ_NO_DATA;
+      return DS_RAW_INVALID;
+    }
+    if (crc8_maxim(sp, 8) != sp[8])
+    {
+      crcErrors_++;
+      lastError_ = DS_READ_CRC;
+      return DS_RAW_INVALID;
+    }
+    lastError_ = DS_READ_OK;
+    int16_t raw = (int16_t)(sp[0] | ((uint16_t)sp[1] << 8));
+    lastBits_ = (uint8_t)(((sp[4] >> 5) & 0x03) + 9);
+    return (int16_t)(raw & ~((1 << (12 - lastBits_)) - 1));
+  }
+
+  DsReadError lastError() const { return lastError_; }
+  uint8_t lastResolution() const { return lastBits_; } // config byte of the last good scratchpad
+
+  bool parasite() const { return parasite_; }
+  uint32_t conversions() const { return conversions_; }
+  uint32_t reads() const { return reads_; }
+  uint32_t crcErrors() const { return crcErrors_; }
+  uint32_t disconnects() const { return disconnects_; }
+  uint32_t alarmSearches() const { return alarmSearches_; }
+  uint32_t alarmHits() const { return alarmHits_; }
+  uint32_t alarmWrites() const { return alarmWrites_; }
+
+private:
+  static const uint8_t CMD_CONVERT = 0x44;
+  static const uint8_t CMD_WRITE_SCRATCH = 0x4E;
+  static const uint8_t CMD_READ_SCRATCH = 0xBE;
+  static const uint8_t CMD_READ_POWER = 0xB4;
+
+  Bus &bus_;
+  int8_t th_ = 125; // alarm thresholds parked out of range (alarm search never matches)
+  int8_t tl_ = -55;
+  uint8_t bits_ = 12;
+  bool parasite_ = false;
+  DsReadError lastError_ = DS_READ_OK;
+  uint8_t lastBits_ = 12;
+  uint32_t conversions_ = 0;
+  uint32_t reads_ = 0;
+  uint32_t crcErrors_ = 0;
+  uint32_t disconnects_ = 0;
+  uint16_t configGen_ = 0;
+  uint32_t alarmSearches_ = 0;
+  uint32_t alarmHits_ = 0;
+  uint32_t alarmWrites_ = 0;
+};
+
+// Resolution for a reading distCd (0.01 °C) away from the nearest control threshold:
+//   < 0.5 °C -> 12 bit (0.0625 °C, 750 ms), < 1.5 °C -> 10 bit (0.25 °C, 188 ms), else 9 bit (94 ms).
+// Finer is taken at once; coarser only once the distance clears the tier edge by a margin,
+// so a reading sitting on an edge does not flip the resolution every sample.
+static inline uint8_t ds_pick_resolution(int16_t distCd, uint8_t cur)
+{
+  static const int16_t NEAR_CD = 50;
+  static const int16_t MID_CD = 150;
+  static const int16_t MARGIN_CD = 10;
+  if (distCd < 0) // no reading yet -> full precision
+    return 12;
+  uint8_t want = distCd < NEAR_CD ? 12 : (distCd < MID_CD ? 10 : 9);
+  if (want >= cur)
+    return want;
+  int16_t d = distCd - MARGIN_CD;
+  uint8_t coarse = d < NEAR_CD ? 12 : (d < MID_CD ? 10 : 9);
+  return coarse < cur ? coarse : cur;
+}
+
+// TH/TL (whole °C, compared against the integer part of the reading) that fire no later than
+// the hysteresis would switch: idle -> alarm once T < onThCd (TL = ceil(onTh) - 1), heating ->
+// alarm once T > offThCd (TH = floor(offTh)). Up to 1 °C early, never late.
+static inline int16_t ds_floor_c(int16_t cd) { return (int16_t)(cd >= 0 ? cd / 100 : -((-cd + 99) / 100)); }
+
+static inline void ds_alarm_thresholds(int16_t onThCd, int16_t offThCd, bool heating, int8_t &th, int8_t &tl)
+{
+  th = 125;
+  tl = -55;
+  if (heating)
+  {
+    int16_t h = ds_floor_c(offThCd);
+    th = (int8_t)(h > 125 ? 125 : (h < -55 ? -55 : h));
+  }
+  else
+  {
+    int16_t l = (int16_t)(-ds_floor_c((int16_t)-onThCd) - 1); // ceil - 1
+    tl = (int8_t)(l > 125 ? 125 : (l < -55 ? -55 : l));
+  }
+}
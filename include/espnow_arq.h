@@ -0,0 +1,119 @@
+// include/espnow_arq.h — retransmission timing + link-quality estimate for ESP-NOW commands
+// - ArqTimer: retries an unacknowledged state change with exponential backoff and +/- jitter
+//   (jitter keeps several zones/relays from retrying in lock-step after a shared fade)
+// - LinkQuality: EWMA of success/failure samples in per-mille, with up/down hysteresis
+// - Integer only, no heap, no Arduino dependencies: the caller passes the clock in
+
+#pragma once
+
+#include <stdint.h>
+
+struct ArqConfig
+{
+  uint16_t baseMs;    // first retry after this (must exceed typical ACK RTT)
+  uint16_t maxMs;     // backoff cap
+  uint8_t maxRetries; // then give up until the next state change / heartbeat
+  uint8_t jitterPct;  // +/- percentage applied to every interval
+};
+
+static const uint8_t ARQ_MAX_RETRIES = 6;
+
+// 60+120+240+480 ms: four retries land inside one second on a lossy link
+static const ArqConfig ARQ_DEFAULTS = {60, 1000, ARQ_MAX_RETRIES, 25};
+
+class ArqTimer
+{
+public:
+  void seed(uint32_t s) { rng_ = s ? s : 0x9E3779B9UL; }
+
+  // New state change sent: arm the first retry.
+  void start(uint32_t nowMs, const ArqConfig &cfg)
+  {
+    active_ = true;
+    attempts_ = 0;
+    backoffMs_ = cfg.baseMs;
+    deadlineMs_ = nowMs + jittered(backoffMs_, cfg);
+  }
+
+  void stop() { active_ = false; }
+  bool active() const { return active_; }
+  bool due(uint32_t nowMs) const { return active_ && (int32_t)(nowMs - deadlineMs_) >= 0; }
+
+  // Deadline passed without ACK. True -> resend now (next retry armed); false -> gave up.
+  bool onTimeout(uint32_t nowMs, const ArqConfig &cfg)
+  {
+    if (attempts_ >= cfg.maxRetries)
+    {
+      active_ = false;
+      giveUps_++;
+      return false;
+    }
+    attempts_++;
+    retries_++;
+    uint32_t next = (uint32_t)backoffMs_ * 2;
+    backoffMs_ = (uint16_t)(next > cfg.maxMs ? cfg.maxMs : next);
+    deadlineMs_ = nowMs + jittered(backoffMs_, cfg);
+    return true;
+  }
+
+  uint8_t attempts() const { return attempts_; }
+  uint32_t retries() const { return retries_; }
+  uint32_t giveUps() const { return giveUps_; }
+
+private:
+  uint32_t jittered(uint16_t ms, const ArqConfig &cfg)
+  {
+    // xorshift32
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    uint32_t span = (uint32_t)ms * cfg.jitterPct / 100;
+    if (!span)
+      return ms;
+    return ms - span + rng_ % (2 * span + 1);
+  }
+
+  bool active_ = false;
+  uint8_t attempts_ = 0;
+  uint16_t backoffMs_ = 0;
+  uint32_t deadlineMs_ = 0;
+  uint32_t rng_ = 0x9E3779B9UL;
+  uint32_t retries_ = 0;
+  uint32_t giveUps_ = 0;
+};
+
+class LinkQuality
+{
+public:
+  static const int16_t DOWN_BELOW = 250; // per-mille
+  static const int16_t UP_FROM = 600;
+
+  // One delivery outcome (ACK received / send failed / ACK timed out). Alpha = 1/8.
+  // Returns true when the up/down state flipped.
+  bool sample(bool ok)
+  {
+    const int32_t target = ok ? 1000 : 0;
+    q_ = (int16_t)(q_ + (target - q_) / 8); // stays within 0..1000
+    if (!down_ && q_ < DOWN_BELOW)
+    {
+      down_ = true;
+      downs_++;
+      return true;
+    }
+    if (down_ && q_ >= UP_FROM)
+    {
+      down_ = false;
+      return true;
+    }
+    return false;
+  }
+
+  int16_t permille() const { return q_; }
+  bool down() const { return down_; }
+  uint32_t downEvents() const { return downs_; }
+
+private:
+  int16_t q_ = 1000; // optimistic until proven otherwise
+  bool down_ = false;
+  uint32_t downs_ = 0;
+};
@@ -0,0 +1,89 @@
+// include/espnow_frame.h — binary ESP-NOW frame shared by thermostat and relay
+// - Fixed 9-byte frame, explicit little-endian byte layout (no struct packing assumptions)
+// - No heap, no ArduinoJson: encode/decode are a few dozen instructions
+// - Copy crc8.h along with this file (same CRC-8 as the DS18B20 driver)
+//
+// Layout:
+//   [0] magic 0xA5   [1] version   [2] type   [3] zone/relay id
+//   [4] seq lo       [5] seq hi    [6] value  [7] flags
+//   [8] CRC-8 (Dallas/Maxim, crc8.h) over bytes 0..7
+//
+// CMD: value = heater 0/1.   ACK: value = relay 0/1, flags bit0 = ok, seq echoes the CMD/PROBE.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "crc8.h"
+
+static const uint8_t EF_MAGIC = 0xA5;
+static const uint8_t EF_VERSION = 1;
+static const size_t EF_FRAME_LEN = 9;
+
+enum EfType : uint8_t
+{
+  EF_CMD = 1,
+  EF_ACK = 2,
+  EF_PROBE = 3, // channel scan: relay answers with an ACK (value = current relay state), no actuation
+};
+
+static const uint8_t EF_FLAG_OK = 0x01; // ACK: relay accepted the command
+
+struct EfFrame
+{
+  uint8_t type;
+  uint8_t zone;
+  uint16_t seq;
+  uint8_t value;
+  uint8_t flags;
+};
+
+enum EfResult : uint8_t
+{
+  EF_DECODED = 0,
+  EF_ERR_SHORT,
+  EF_ERR_MAGIC,
+  EF_ERR_VERSION,
+  EF_ERR_CRC,
+};
+
+// First byte is enough to tell a binary frame from a legacy JSON one ('{').
+static inline bool ef_is_binary(const uint8_t *buf, size_t len)
+{
+  return len > 0 && buf[0] == EF_MAGIC;
+}
+
+// Returns bytes written (EF_FRAME_LEN) or 0 if cap is too small.
+static inline size_t ef_encode(const EfFrame &f, uint8_t *buf, size_t cap)
+{
+  if (cap < EF_FRAME_LEN)
+    return 0;
+  buf[0] = EF_MAGIC;
+  buf[1] = EF_VERSION;
+  buf[2] = f.type;
+  buf[3] = f.zone;
+  buf[4] = (uint8_t)(f.seq & 0xFF);
+  buf[5] = (uint8_t)(f.seq >> 8);
+  buf[6] = f.value;
+  buf[7] = f.flags;
+  buf[8] = crc8_maxim(buf, EF_FRAME_LEN - 1);
+  return EF_FRAME_LEN;
+}
+
+static inline EfResult ef_decode(const uint8_t *buf, size_t len, EfFrame &out)
+{
+  if (len < EF_FRAME_LEN)
+    return EF_ERR_SHORT;
+  if (buf[0] != EF_MAGIC)
+    return EF_ERR_MAGIC;
+  if (buf[1] != EF_VERSION)
+    return EF_ERR_VERSION;
+  if (crc8_maxim(buf, EF_FRAME_LEN - 1) != buf[8])
+    return EF_ERR_CRC;
+  out.type = buf[2];
+  out.zone = buf[3];
+  out.seq = (uint16_t)(buf[4] | ((uint16_t)buf[5] << 8));
+  out.value = buf[6];
+  out.flags = buf[7];
+  return EF_DECODED;
+}
@@ -0,0 +1,200 @@
+// include/espnow_stats.h — ACK correlation + round-trip statistics for ESP-NOW commands
+// - InflightTable: small fixed table of sent sequence numbers awaiting their echoed ACK
+//   (matched / duplicate / stale classification, timeout -> lost)
+// - RttHistogram: fixed log-ish buckets in ms, percentiles from the cumulative counts
+// - No heap, no Arduino dependencies: all times are passed in by the caller
+
+#pragma once
+
+#include <stdint.h>
+#include "espnow_arq.h"
+
+// Zones (relays) one thermostat drives, and the in-flight slots they need: every zone may have
+// its command plus all ARQ resends pending at once (all zones send in the same control tick at
+// boot, and the shared heartbeat keeps them aligned). Fewer slots evict live entries, and the
+// ACKs that come back for them are dropped as stale.
+static const uint8_t ESPNOW_MAX_ZONES = 10;
+static const uint8_t ESPNOW_INFLIGHT_SLOTS = ESPNOW_MAX_ZONES * (1 + ARQ_MAX_RETRIES);
+
+enum AckMatch : uint8_t
+{
+  ACK_MATCHED = 0, // first ACK for an in-flight seq
+  ACK_DUPLICATE,   // seq already acknowledged
+  ACK_STALE,       // seq unknown (expired, evicted or never sent)
+};
+
+template <uint8_t N>
+class InflightTable
+{
+public:
+  // Track a new command; tag is caller data handed back on match/loss (e.g. zone index).
+  // A full table evicts the oldest pending entry (counted lost).
+  void add(uint16_t seq, uint32_t nowMs, uint8_t tag = 0)
+  {
+    Slot *victim = &slots_[0];
+    for (uint8_t i = 0; i < N; ++i)
+    {
+      Slot &s = slots_[i];
+      if (s.state == FREE)
+      {
+        victim = &s;
+        break;
+      }
+      if ((int32_t)(s.sentMs - victim->sentMs) < 0)
+        victim = &s;
+    }
+    if (victim->state == PENDING)
+      lost_++;
+    victim->seq = seq;
+    victim->sentMs = nowMs;
+    victim->tag = tag;
+    victim->state = PENDING;
+    sent_++;
+  }
+
+  AckMatch match(uint16_t seq, uint32_t atMs, uint32_t &rttMs)
+  {
+    uint8_t tag;
+    return match(seq, atMs, rttMs, tag);
+  }
+
+  AckMatch match(uint16_t seq, uint32_t atMs, uint32_t &rttMs, uint8_t &tag)
+  {
+    for (uint8_t i = 0; i < N; ++i)
+    {
+      Slot &s = slots_[i];
+      if (s.state == FREE || s.seq != seq)
+        continue;
+      if (s.state == ACKED)
+      {
+        dup_++;
+        return ACK_DUPLICATE;
+      }
+      s.state = ACKED; // kept until timeout so late duplicates are recognised
+      rttMs = atMs - s.sentMs;
+      tag = s.tag;
+      acked_++;
+      return ACK_MATCHED;
+    }
+    stale_++;
+    return ACK_STALE;
+  }
+
+  // Pending entries older than timeoutMs are lost; acknowledged ones are released.
+  void expire(uint32_t nowMs, uint32_t timeoutMs)
+  {
+    expire(nowMs, timeoutMs, [](uint8_t) {});
+  }
+
+  // Same, calling onLost(tag) for every entry that timed out unacknowledged.
+  template <typename F>
+  void expire(uint32_t nowMs, uint32_t timeoutMs, F onLost)
+  {
+    for (uint8_t i = 0; i < N; ++i)
+    {
+      Slot &s = slots_[i];
+      if (s.state == FREE || nowMs - s.sentMs < timeoutMs)
+        continue;
+      if (s.state == PENDING)
+      {
+        lost_++;
+        onLost(s.tag);
+      }
+      s.state = FREE;
+    }
+  }
+
+  uint8_t pending() const
+  {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < N; ++i)
+      if (slots_[i].state == PENDING)
+        n++;
+    return n;
+  }
+
+  uint32_t sent() const { return sent_; }
+  uint32_t acked() const { return acked_; }
+  uint32_t lost() const { return lost_; }
+  uint32_t duplicates() const { return dup_; }
+  uint32_t stale() const { return stale_; }
+
+  // lost / (acked + lost), in per-mille so callers need no float
+  uint16_t lossPermille() const
+  {
+    uint32_t done = acked_ + lost_;
+    return done ? (uint16_t)((lost_ * 1000UL) / done) : 0;
+  }
+
+private:
+  enum State : uint8_t
+  {
+    FREE = 0,
+    PENDING,
+    ACKED,
+  };
+  struct Slot
+  {
+    uint16_t seq;
+    uint32_t sentMs;
+    uint8_t tag;
+    State state;
+  };
+  Slot slots_[N] = {};
+  uint32_t sent_ = 0;
+  uint32_t acked_ = 0;
+  uint32_t lost_ = 0;
+  uint32_t dup_ = 0;
+  uint32_t stale_ = 0;
+};
+
+class RttHistogram
+{
+public:
+  static const uint8_t BUCKETS = 10;
+
+  // Upper bound (inclusive, ms) of bucket i; the last bucket is open-ended.
+  static uint32_t upperMs(uint8_t i)
+  {
+    static const uint32_t UB[BUCKETS] = {2, 5, 10, 20, 50, 100, 200, 500, 1000, 0xFFFFFFFFUL};
+    return UB[i < BUCKETS ? i : BUCKETS - 1];
+  }
+
+  void add(uint32_t ms)
+  {
+    uint8_t i = 0;
+    while (i < BUCKETS - 1 && ms > upperMs(i))
+      i++;
+    counts_[i]++;
+    total_++;
+    if (ms > max_)
+      max_ = ms;
+  }
+
+  // Smallest bucket bound covering pct% of samples (max observed for the open bucket).
+  uint32_t percentileMs(uint8_t pct) const
+  {
+    if (!total_)
+      return 0;
+    uint32_t need = (total_ * pct + 99) / 100;
+    if (need == 0)
+      need = 1;
+    uint32_t cum = 0;
+    for (uint8_t i = 0; i < BUCKETS; ++i)
+    {
+      cum += counts_[i];
+      if (cum >= need)
+        return (i == BUCKETS - 1 || upperMs(i) > max_) ? max_ : upperMs(i);
+    }
+    return max_;
+  }
+
+  uint32_t count(uint8_t i) const { return i < BUCKETS ? counts_[i] : 0; }
+  uint32_t total() const { return total_; }
+  uint32_t maxMs() const { return max_; }
+
+private:
+  uint32_t counts_[BUCKETS] = {};
+  uint32_t total_ = 0;
+  uint32_t max_ = 0;
+};
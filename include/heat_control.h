@@ -0,0 +1,182 @@
+// include/heat_control.h — control core shared by the firmware loop and the plant simulator
+// - Strict hysteresis with the hard heating cutoff (0.01 °C, integer compares only)
+// - Stale-reading check: a sample too old to act on counts as no reading
+// - Heater output: minimum ON/OFF times, max ON with cooldown, wrap-safe timers, counters
+// - No Arduino dependencies: the caller passes the clock in, so the same code runs in
+//   accelerated time against include/thermal_sim.h
+
+#pragma once
+
+#include <stdint.h>
+#include "centideg.h"
+
+// ===== Hysteresis (0.01 °C, total band) =====
+static const cdeg_t HYST_BAND_CD = 50;     // +/- 0.25°C around setpoint
+static const cdeg_t HEAT_CUTOFF_CD = 1980; // never heat at or above 19.8°C, whatever the setpoint
+
+// --- Strict 0.5 °C hysteresis (±0.25 °C): ON when temp < sp-0.25, OFF when temp > sp+0.25
+static inline uint8_t apply_hysteresis(cdeg_t temp, cdeg_t sp, uint8_t prev)
+{
+  const cdeg_t half = HYST_BAND_CD / 2;        // 25
+  const int16_t on_th = (int16_t)(sp - half);  // below => ON
+  const int16_t off_th = (int16_t)(sp + half); // above => OFF
+  if (temp >= HEAT_CUTOFF_CD)
+    return 0;
+  if (temp < on_th)
+    return 1; // strictly less
+  if (temp > off_th)
+    return 0; // strictly greater
+
+  return prev; // inside band -> hold
+}
+
+// Reading for a control decision: CDEG_INVALID once the sample behind it is staleMs old, so a
+// lost or silent sensor ends in the fail-safe OFF instead of control on a frozen value
+static inline cdeg_t temp_if_fresh(cdeg_t temp, uint32_t atMs, uint32_t nowMs, uint32_t staleMs)
+{
+  return (cdeg_valid(temp) && nowMs - atMs < staleMs) ? temp : CDEG_INVALID;
+}
+
+// ===== Heater output: anti-short-cycle state machine =====
+// OFF -> ON only after minOffMs OFF, ON -> OFF only after minOnMs ON (fail-safe OFF excepted),
+// ON for maxOnMs -> COOLDOWN for cooldownMs. Every timer is "now - since >= duration", so
+// nothing breaks at the 49.7-day millis() rollover; a served dwell is latched so that a state
+// held longer than 2^32 ms does not re-arm its own minimum either.
+enum HeaterState : uint8_t
+{
+  HS_OFF = 0,
+  HS_ON,
+  HS_COOLDOWN, // forced OFF after maxOnMs
+  HS_COUNT,
+};
+
+enum HeaterEvent : uint8_t
+{
+  HE_NONE = 0,
+  HE_ON,
+  HE_OFF,
+  HE_COOLDOWN, // max ON reached: forced OFF starts
+  HE_RELEASED, // cooldown over, normal control resumed
+};
+
+struct HeaterConfig
+{
+  uint32_t minOnMs;
+  uint32_t minOffMs;
+  uint32_t maxOnMs; // 0 = no limit
+  uint32_t cooldownMs;
+};
+
+// 3 min minimum ON/OFF, 1 h max ON, 30 min cooldown
+static const HeaterConfig HEATER_DEFAULTS = {180000UL, 180000UL, 3600000UL, 1800000UL};
+
+class HeaterOutput
+{
+public:
+  // want: controller request. forceOff: fail-safe OFF (no reading, cutoff, link down) that does
+  // not wait for minOnMs. Returns the output to drive.
+  bool update(bool want, bool forceOff, uint32_t nowMs, const HeaterConfig &cfg)
+  {
+    account(nowMs);
+    ev_ = HE_NONE;
+    const uint32_t in = nowMs - sinceMs_;
+    bool held = false; // a request deferred by a minimum time this tick
+    switch (state_)
+    {
+    case HS_ON:
+      if (!served_ && in >= cfg.minOnMs)
+        served_ = true; // latched: with maxOnMs = 0 an ON state can outlast 2^32 ms
+      if (cfg.maxOnMs && in >= cfg.maxOnMs)
+      {
+        enter(HS_COOLDOWN, nowMs, HE_COOLDOWN);
+        cooldowns_++;
+      }
+      else if (forceOff)
+      {
+        enter(HS_OFF, nowMs, HE_OFF);
+        forcedOffs_++;
+      }
+      else if (!want)
+      {
+        if (served_)
+          enter(HS_OFF, nowMs, HE_OFF);
+        else
+          held = true;
+      }
+      break;
+    case HS_OFF:
+      if (!served_ && in >= cfg.minOffMs)
+        served_ = true; // latched: immune to the elapsed time wrapping
+      if (want && !forceOff)
+      {
+        if (served_)
+        {
+          enter(HS_ON, nowMs, HE_ON);
+          cycles_++;
+        }
+        else
+          held = true;
+      }
+      break;
+    default: // HS_COOLDOWN
+      if (in >= cfg.cooldownMs)
+      {
+        enter(HS_OFF, nowMs, HE_RELEASED);
+        served_ = true; // the cooldown covers the minimum OFF time
+      }
+      break;
+    }
+    if (held && !holding_)
+      (state_ == HS_ON ? heldOn_ : heldOff_)++; // count each deferral once, not per tick
+    holding_ = held;
+    return state_ == HS_ON;
+  }
+
+  HeaterState state() const { return state_; }
+  HeaterEvent event() const { return ev_; } // what the last update() did
+  bool on() const { return state_ == HS_ON; }
+  uint32_t inStateMs(uint32_t nowMs) const { return started_ ? nowMs - sinceMs_ : 0; }
+
+  uint32_t cycles() const { return cycles_; }         // OFF -> ON
+  uint32_t cooldowns() const { return cooldowns_; }   // max-ON trips
+  uint32_t forcedOffs() const { return forcedOffs_; } // fail-safe OFF inside minOnMs or later
+  uint32_t heldOn() const { return heldOn_; }         // OFF requests deferred by minOnMs
+  uint32_t heldOff() const { return heldOff_; }       // ON requests deferred by minOffMs
+  uint64_t timeInMs(HeaterState s) const { return s < HS_COUNT ? timeMs_[s] : 0; }
+
+private:
+  void account(uint32_t nowMs)
+  {
+    if (!started_)
+    {
+      started_ = true;
+      sinceMs_ = lastMs_ = nowMs;
+      served_ = true; // boot: no dwell to honour
+      return;
+    }
+    timeMs_[state_] += nowMs - lastMs_;
+    lastMs_ = nowMs;
+  }
+
+  void enter(HeaterState s, uint32_t nowMs, HeaterEvent ev)
+  {
+    state_ = s;
+    sinceMs_ = nowMs;
+    served_ = false;
+    ev_ = ev;
+  }
+
+  HeaterState state_ = HS_OFF;
+  HeaterEvent ev_ = HE_NONE;
+  bool started_ = false;
+  bool served_ = false;
+  bool holding_ = false;
+  uint32_t sinceMs_ = 0;
+  uint32_t lastMs_ = 0;
+  uint32_t cycles_ = 0;
+  uint32_t cooldowns_ = 0;
+  uint32_t forcedOffs_ = 0;
+  uint32_t heldOn_ = 0;
+  uint32_t heldOff_ = 0;
+  uint64_t timeMs_[HS_COUNT] = {};
+};
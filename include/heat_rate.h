@@ -0,0 +1,155 @@
+// include/heat_rate.h — incremental heating/cooling rate learner for optimal start
+// - Each stretch with the relay held ON (or OFF) is fitted with a running least-squares line:
+//   five sums updated per sample (one every 10 s at most), O(1) time and memory, no buffer
+// - The first RATE_DEAD_MS of a stretch are skipped (radiator warm-up / residual heat)
+// - A finished stretch of at least RATE_MIN_SPAN_S folds its slope into a per-state EMA
+// - Rates in 0.01 °C per hour (int16); the 12-byte state is what gets persisted
+// - preheatMs(): fixed RATE_DEAD_MS offset + distance / learned heating rate, the lead an optimal start needs
+// - No Arduino dependencies: the caller passes the clock in
+
+#pragma once
+
+#include <stdint.h>
+#include "centideg.h"
+
+struct HeatRateState
+{
+  int32_t heatX16;   // heating rate EMA, 0.01 °C/h x 16
+  int32_t coolX16;   // cooling rate EMA (negative when the room cools)
+  uint16_t heatSegs; // stretches folded in (0 = rate unknown)
+  uint16_t coolSegs;
+};
+
+class HeatRateLearner
+{
+public:
+  static const uint32_t RATE_DEAD_MS = 600000UL;  // 10 min skipped after every relay change
+  static const uint32_t RATE_MIN_SPAN_S = 600;    // a usable stretch covers >= 10 min of fit
+  static const uint32_t RATE_MAX_SPAN_S = 7200;   // long stretches are cut every 2 h (int64 headroom)
+  static const uint32_t RATE_MAX_GAP_MS = 60000;  // no sample for 1 min -> stretch dropped
+  static const uint32_t RATE_SAMPLE_MS = 10000;   // fit at most one sample per 10 s (bounds the sums)
+  static const int16_t RATE_LIMIT_CD_H = 2000;    // |slope| clamp, 20 °C/h
+  static const uint8_t RATE_EMA_SHIFT = 2;        // new stretch weighs 1/4
+
+  // One sample taken with the relay in `heating` state. Invalid readings drop the stretch.
+  void push(cdeg_t t, bool heating, uint32_t nowMs)
+  {
+    if (!cdeg_valid(t))
+    {
+      active_ = false;
+      return;
+    }
+    if (active_ && heating != heating_)
+      finish(); // relay changed: the stretch is complete
+    else if (active_ && nowMs - lastMs_ > RATE_MAX_GAP_MS)
+      active_ = false; // hole in the data: do not fit across it
+
+    if (!active_)
+    {
+      active_ = true;
+      heating_ = heating;
+      startMs_ = nowMs;
+      n_ = 0;
+    }
+    lastMs_ = nowMs;
+    if (nowMs - startMs_ < RATE_DEAD_MS)
+      return;
+
+    if (n_ && nowMs - fitMs_ < RATE_SAMPLE_MS)
+      return;
+    fitMs_ = nowMs;
+    if (!n_)
+    {
+      t0Ms_ = nowMs;
+      y0_ = t;
+      sx_ = sy_ = sxx_ = sxy_ = 0;
+    }
+    const int64_t x = (int64_t)((nowMs - t0Ms_) / 1000); // s
+    const int64_t y = (int64_t)t - y0_;                  // 0.01 °C
+    n_++;
+    sx_ += x;
+    sy_ += y;
+    sxx_ += x * x;
+    sxy_ += x * y;
+    lastX_ = (uint32_t)x;
+
+    if (x >= (int64_t)RATE_MAX_SPAN_S)
+    {
+      finish();
+      active_ = true; // continue the same stretch, already past its dead time
+      n_ = 0;
+    }
+  }
+
+  bool known(bool heating) const { return (heating ? st_.heatSegs : st_.coolSegs) != 0; }
+  int16_t heatCdPerH() const { return (int16_t)((st_.heatX16 + 8) >> 4); }
+  int16_t coolCdPerH() const { return (int16_t)((st_.coolX16 + 8) >> 4); }
+
+  // Lead time to bring the room from `from` to `to` with the heater ON, capped at maxMs.
+  // 0 when no rise is needed or nothing was learned yet; maxMs when heating cannot gain.
+  uint32_t preheatMs(cdeg_t from, cdeg_t to, uint32_t maxMs) const
+  {
+    if (!cdeg_valid(from) || !cdeg_valid(to) || to <= from || !st_.heatSegs)
+      return 0;
+    const int32_t rate = heatCdPerH();
+    if (rate <= 0)
+      return maxMs;
+    const uint64_t ms = RATE_DEAD_MS + (uint64_t)(to - from) * 3600000ULL / (uint32_t)rate;
+    return ms > maxMs ? maxMs : (uint32_t)ms;
+  }
+
+  // Seconds fitted so far in the current stretch (UI)
+  uint32_t stretchS() const { return active_ && n_ ? lastX_ : 0; }
+  bool stretchHeating() const { return heating_; }
+
+  const HeatRateState &state() const { return st_; }
+  void restore(const HeatRateState &s) { st_ = s; }
+
+  // True once after every stretch folded in (persistence trigger)
+  bool takeDirty()
+  {
+    bool d = dirty_;
+    dirty_ = false;
+    return d;
+  }
+
+private:
+  void finish()
+  {
+    active_ = false;
+    if (n_ < 10 || lastX_ < RATE_MIN_SPAN_S)
+      return;
+    const int64_t den = (int64_t)n_ * sxx_ - sx_ * sx_;
+    if (den <= 0)
+      return;
+    int64_t slope = ((int64_t)n_ * sxy_ - sx_ * sy_) * 3600 / den; // 0.01 °C per hour
+    if (slope > RATE_LIMIT_CD_H)
+      slope = RATE_LIMIT_CD_H;
+    if (slope < -RATE_LIMIT_CD_H)
+      slope = -RATE_LIMIT_CD_H;
+
+    int32_t &ema = heating_ ? st_.heatX16 : st_.coolX16;
+    uint16_t &segs = heating_ ? st_.heatSegs : st_.coolSegs;
+    if (!segs)
+      ema = (int32_t)slope * 16;
+    else
+      ema += ((int32_t)slope * 16 - ema) >> RATE_EMA_SHIFT;
+    if (segs < 0xFFFF)
+      segs++;
+    dirty_ = true;
+  }
+
+  HeatRateState st_ = {};
+  bool dirty_ = false;
+
+  bool active_ = false;
+  bool heating_ = false;
+  uint32_t startMs_ = 0;
+  uint32_t lastMs_ = 0;
+  uint32_t t0Ms_ = 0;
+  uint32_t fitMs_ = 0;
+  cdeg_t y0_ = 0;
+  uint32_t n_ = 0;
+  uint32_t lastX_ = 0;
+  int64_t sx_ = 0, sy_ = 0, sxx_ = 0, sxy_ = 0;
+};
@@ -0,0 +1,119 @@
+// include/report_policy.h — change-driven telemetry for the cesana poll
+// - A report (temp + cald) goes out only when the temperature moved >= deltaCd from the value
+//   last sent, when cald changed, or when heartbeatMs passed since the last report
+// - Between reports a setpoint pull (no temp/cald) every pullMs keeps mode, setpoint and the
+//   schedule version current; any successful reply restarts the pull timer
+// - A failed request leaves the values pending and is retried after retryMs
+// - Compared against the last value *sent*, so slow drift still crosses deltaCd eventually
+// - Wrap-safe millis() arithmetic; no Arduino dependencies: the caller passes the clock in
+
+#pragma once
+
+#include <stdint.h>
+#include "centideg.h"
+
+enum ReportReason : uint8_t
+{
+  RR_NONE = 0,
+  RR_FIRST,     // nothing reported since boot
+  RR_FORCED,    // force(): e.g. a reply is needed before deep sleep
+  RR_CALD,      // relay state changed
+  RR_DELTA,     // temperature moved >= deltaCd
+  RR_HEARTBEAT, // heartbeatMs without a report
+  RR_PULL,      // setpoint pull only, nothing to report
+  RR_COUNT
+};
+
+struct ReportConfig
+{
+  cdeg_t deltaCd;       // temperature change that triggers a report
+  uint32_t heartbeatMs; // report at least this often (server history logs every 10 min)
+  uint32_t pullMs;      // setpoint pull cadence between reports
+  uint32_t retryMs;     // wait after a failed request
+};
+
+// 0.2 °C, 5 min heartbeat, 30 s pulls: ~3k requests/day instead of ~57k at 1.5 s
+static const ReportConfig REPORT_DEFAULTS = {20, 300000UL, 30000UL, 5000UL};
+
+class ReportPolicy
+{
+public:
+  // What to send now (RR_NONE = nothing). An invalid temp never triggers a report, only pulls.
+  uint8_t due(const ReportConfig &c, cdeg_t temp, bool cald, uint32_t nowMs) const
+  {
+    if (failed_ && nowMs - failMs_ < c.retryMs)
+      return RR_NONE;
+    if (cdeg_valid(temp))
+    {
+      if (!sent_)
+        return RR_FIRST;
+      if (forced_)
+        return RR_FORCED;
+      if (cald != sentCald_)
+        return RR_CALD;
+      const int32_t d = (int32_t)temp - sentTemp_;
+      if (d >= c.deltaCd || -d >= c.deltaCd)
+        return RR_DELTA;
+      if (nowMs - sentMs_ >= c.heartbeatMs)
+        return RR_HEARTBEAT;
+    }
+    if (!replied_ || forced_ || nowMs - replyMs_ >= c.pullMs)
+      return RR_PULL;
+    return RR_NONE;
+  }
+
+  // Outcome of the request due() asked for; temp/cald are the values that went out
+  void done(uint8_t reason, bool ok, cdeg_t temp, bool cald, uint32_t nowMs)
+  {
+    if (reason >= RR_COUNT)
+      return;
+    counts_[reason]++;
+    if (!ok)
+    {
+      failed_ = true;
+      failMs_ = nowMs;
+      fails_++;
+      return;
+    }
+    failed_ = false;
+    forced_ = false;
+    replied_ = true;
+    replyMs_ = nowMs;
+    if (reason != RR_PULL)
+    {
+      sent_ = true;
+      sentTemp_ = temp;
+      sentCald_ = cald;
+      sentMs_ = nowMs;
+    }
+  }
+
+  void force() { forced_ = true; }
+
+  uint32_t count(uint8_t reason) const { return reason < RR_COUNT ? counts_[reason] : 0; }
+  uint32_t fails() const { return fails_; }
+  bool sent() const { return sent_; }
+  cdeg_t sentTemp() const { return sentTemp_; }
+  bool sentCald() const { return sentCald_; }
+  uint32_t sentMs() const { return sentMs_; }
+  uint32_t replyMs() const { return replyMs_; }
+
+private:
+  bool sent_ = false;
+  bool replied_ = false;
+  bool forced_ = false;
+  bool failed_ = false;
+  cdeg_t sentTemp_ = CDEG_INVALID;
+  bool sentCald_ = false;
+  uint32_t sentMs_ = 0;
+  uint32_t replyMs_ = 0;
+  uint32_t failMs_ = 0;
+  uint32_t counts_[RR_COUNT] = {};
+  uint32_t fails_ = 0;
+};
+
+static inline const char *report_reason_name(uint8_t r)
+{
+  static const char *const names[RR_COUNT] = {"none", "first", "forced", "cald", "delta", "heartbeat", "pull"};
+  return r < RR_COUNT ? names[r] : "?";
+}
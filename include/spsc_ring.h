@@ -0,0 +1,63 @@
+// include/spsc_ring.h — fixed-capacity single-producer/single-consumer ring buffer
+// - Lock-free: producer only writes head_, consumer only writes tail_ (plain atomic loads/stores,
+//   no read-modify-write, so no libatomic needed on the ESP8266)
+// - Static storage, no heap; N must be a power of two
+// - Overflow and high-water counters are written by the producer only
+// - Portable C++11: the same header builds on the host for threaded tests
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, uint16_t N>
+class SpscRing
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+  // Producer side. Returns false (and counts an overflow) when full.
+  bool push(const T &v)
+  {
+    const uint16_t h = head_.load(std::memory_order_relaxed);
+    const uint16_t t = tail_.load(std::memory_order_acquire);
+    const uint16_t used = (uint16_t)(h - t);
+    if (used >= N)
+    {
+      overflows_.store(overflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    buf_[h & (N - 1)] = v;
+    head_.store((uint16_t)(h + 1), std::memory_order_release);
+    if (used + 1 > highWater_.load(std::memory_order_relaxed))
+      highWater_.store((uint16_t)(used + 1), std::memory_order_relaxed);
+    return true;
+  }
+
+  // Consumer side. Returns false when empty.
+  bool pop(T &out)
+  {
+    const uint16_t t = tail_.load(std::memory_order_relaxed);
+    const uint16_t h = head_.load(std::memory_order_acquire);
+    if (h == t)
+      return false;
+    out = buf_[t & (N - 1)];
+    tail_.store((uint16_t)(t + 1), std::memory_order_release);
+    return true;
+  }
+
+  uint16_t size() const
+  {
+    return (uint16_t)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+  }
+  static constexpr uint16_t capacity() { return N; }
+  uint32_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+  uint16_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+private:
+  T buf_[N];
+  std::atomic<uint16_t> head_{0};
+  std::atomic<uint16_t> tail_{0};
+  std::atomic<uint32_t> overflows_{0};
+  std::atomic<uint16_t> highWater_{0};
+};
@@ -0,0 +1,130 @@
+// include/temp_filter.h — spike-rejecting smoothing filter for 0.01 °C sensor samples
+// - Stage 1: a sample far from the median of the last N accepted ones (or the DS18B20 85.00 °C
+//   power-on value) is rejected; N rejections in a row are taken as a real step and restart
+//   the window
+// - Stage 2: median-of-N over a static ring, then an EMA with alpha = 1/2^shift in x16 fixed point
+// - No heap, no float, no Arduino dependencies
+
+#pragma once
+
+#include <stdint.h>
+#include "centideg.h"
+
+struct TempFilterConfig
+{
+  int16_t spikeCd;  // reject |x - median| above this (0.01 °C)
+  uint8_t emaShift; // EMA alpha = 1 / 2^emaShift (0 = median only)
+};
+
+static const TempFilterConfig TEMP_FILTER_DEFAULTS = {150, 2};
+
+template <uint8_t N>
+class TempFilter
+{
+  static_assert(N >= 1 && N <= 15 && (N & 1), "TempFilter window must be odd, 1..15");
+
+public:
+  static const cdeg_t DS_POWER_ON_CD = 8500; // scratchpad reset value, never a real first reading
+
+  // Feed one sample. Returns the filtered value, or CDEG_INVALID until the first accepted sample.
+  cdeg_t push(cdeg_t x, const TempFilterConfig &cfg)
+  {
+    if (!cdeg_valid(x))
+      return out();
+    if (suspect(x, cfg))
+    {
+      if (++rejectRun_ < N)
+      {
+        rejected_++;
+        return out();
+      }
+      restarts_++; // persistent: accept as a genuine step, forget the old level
+      count_ = 0;
+      primed_ = false;
+    }
+    rejectRun_ = 0;
+    accepted_++;
+    ring_[head_] = x;
+    head_ = (uint8_t)((head_ + 1) % N);
+    if (count_ < N)
+      count_++;
+
+    const int32_t med = median();
+    if (!primed_ || !cfg.emaShift)
+    {
+      emaX16_ = med * 16;
+      primed_ = true;
+    }
+    else
+      emaX16_ += (med * 16 - emaX16_) >> cfg.emaShift; // arithmetic shift: floor, fine at x16
+
+    int32_t lag = x - out();
+    lagLastCd_ = (uint16_t)(lag < 0 ? -lag : lag);
+    if (lagLastCd_ > lagMaxCd_)
+      lagMaxCd_ = lagLastCd_;
+    return out();
+  }
+
+  cdeg_t out() const { return primed_ ? (cdeg_t)((emaX16_ + 8) >> 4) : CDEG_INVALID; }
+
+  void reset()
+  {
+    count_ = 0;
+    head_ = 0;
+    rejectRun_ = 0;
+    primed_ = false;
+  }
+
+  // Group delay in samples: (N-1)/2 for the median plus (2^shift - 1) for the EMA
+  static uint8_t lagSamples(const TempFilterConfig &cfg)
+  {
+    return (uint8_t)((N - 1) / 2 + (cfg.emaShift ? (1u << cfg.emaShift) - 1 : 0));
+  }
+
+  uint32_t accepted() const { return accepted_; }
+  uint32_t rejected() const { return rejected_; }
+  uint32_t restarts() const { return restarts_; }
+  uint16_t lagLastCd() const { return lagLastCd_; } // |input - output| of the last sample
+  uint16_t lagMaxCd() const { return lagMaxCd_; }
+
+private:
+  bool suspect(cdeg_t x, const TempFilterConfig &cfg) const
+  {
+    if (!count_)
+      return x == DS_POWER_ON_CD;
+    int32_t d = x - median();
+    if (d < 0)
+      d = -d;
+    return d > cfg.spikeCd || (x == DS_POWER_ON_CD && d > 0);
+  }
+
+  // Median of the accepted window (insertion sort on a stack copy, N <= 15)
+  cdeg_t median() const
+  {
+    cdeg_t w[N];
+    for (uint8_t i = 0; i < count_; ++i)
+    {
+      cdeg_t v = ring_[(uint8_t)((head_ + N - count_ + i) % N)];
+      uint8_t j = i;
+      while (j && w[j - 1] > v)
+      {
+        w[j] = w[j - 1];
+        j--;
+      }
+      w[j] = v;
+    }
+    return w[count_ / 2];
+  }
+
+  cdeg_t ring_[N] = {};
+  uint8_t head_ = 0;
+  uint8_t count_ = 0;
+  uint8_t rejectRun_ = 0;
+  bool primed_ = false;
+  int32_t emaX16_ = 0;
+  uint32_t accepted_ = 0;
+  uint32_t rejected_ = 0;
+  uint32_t restarts_ = 0;
+  uint16_t lagLastCd_ = 0;
+  uint16_t lagMaxCd_ = 0;
+};
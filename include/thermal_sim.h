@@ -0,0 +1,235 @@
+// include/thermal_sim.h — first-order room/boiler plant for accelerated-time controller runs
+// - Room: dT/dt = heat x radiator - loss x (T - Toutdoor), radiator output lags the command
+//   through a first-order boiler/emitter constant; outdoor follows a triangular daily wave
+// - State in 1e-6 °C (int64), no float: runs are deterministic across compilers
+// - Sensor path: 1/16 °C quantisation like the DS18B20 plus optional deterministic noise
+// - sim_run() drives any controller functor (sensor, sp, nowMs) -> heater with a simulated
+//   clock, so a month of operation runs in well under a second on a host
+// - SimControlLoop: the firmware's per-zone decision (filter -> hysteresis or TPI -> heater
+//   output) as such a functor, with counters for requested vs delivered heater time
+// - Host only (pio test -e native): a month of 30 s steps is far too long for the ESP8266 loop
+
+#pragma once
+
+#include <stdint.h>
+#include "centideg.h"
+#include "heat_control.h"
+#include "temp_filter.h"
+#include "tpi_controller.h"
+
+struct PlantConfig
+{
+  int16_t outdoorMeanCd;     // daily mean outdoor temperature
+  int16_t outdoorSwingCd;    // +/- daily swing (coldest 04:00, warmest 16:00)
+  uint16_t lossPmPerH;       // per-mille of (room - outdoor) lost per hour (1000 / time constant h)
+  uint16_t heatCdPerH;       // room warming rate with the radiator fully hot, losses aside
+  uint32_t radiatorLagS;     // boiler + emitter time constant (0 = instantaneous)
+  int16_t startCd;           // room temperature at t = 0
+  uint8_t noiseRaw16;        // sensor noise, +/- this many 1/16 °C steps (0 = none)
+};
+
+// 5 °C +/- 4 °C outside, ~6.7 h room time constant, 4 °C/h of heat (~26 °C above outdoor at
+// full power), 15 min radiator lag
+static const PlantConfig PLANT_DEFAULTS = {500, 400, 150, 400, 900, 1600, 1};
+
+struct SimSchedule
+{
+  int16_t dayCd;    // comfort setpoint
+  int16_t nightCd;  // setback; <= 10.00 °C is the firmware sleep mode (heater OFF)
+  uint8_t dayStartH;
+  uint8_t dayEndH;
+};
+
+static const SimSchedule SIM_SCHEDULE_DEFAULTS = {1900, 1600, 6, 22};
+
+struct SimReport
+{
+  uint32_t simS;             // simulated seconds
+  uint32_t steps;
+  uint32_t comfortSteps;     // steps with the comfort (day) setpoint active
+  uint32_t comfortAbsErrCd;  // mean |room - sp| during comfort periods
+  uint16_t coldPermille;     // comfort steps with room < sp - 0.50 °C
+  uint16_t onPermille;       // heater command ON time
+  uint32_t cycles;           // OFF -> ON transitions
+  uint16_t cyclesPerHourX100;
+  int16_t maxOvershootCd;    // peak room - sp once the room had reached sp after a change
+  int16_t minRoomCd;
+  int16_t maxRoomCd;
+};
+
+class ThermalPlant
+{
+public:
+  explicit ThermalPlant(const PlantConfig &cfg) : cfg_(cfg), roomU_((int64_t)cfg.startCd * 10000) {}
+
+  // Outdoor temperature at time-of-day tS: triangle, min at 04:00, max at 16:00
+  int32_t outdoorU(uint32_t tS) const
+  {
+    const int32_t day = (int32_t)((tS + 20UL * 3600) % 86400); // 0 at 04:00
+    const int32_t tri = day < 43200 ? day : 86400 - day;      // 0..43200
+    const int64_t swing = (int64_t)cfg_.outdoorSwingCd * 10000;
+    return (int32_t)((int64_t)cfg_.outdoorMeanCd * 10000 - swing + 2 * swing * tri / 43200);
+  }
+
+  // Advance dtS seconds with the heater command held; returns the true room temperature (0.01 °C)
+  cdeg_t step(bool heaterOn, uint32_t dtS, uint32_t tS)
+  {
+    const int64_t target = heaterOn ? 1000000 : 0; // radiator output, 1e-6 of full
+    if (cfg_.radiatorLagS == 0 || dtS >= cfg_.radiatorLagS)
+      radU_ = target;
+    else
+      radU_ += (target - radU_) * (int64_t)dtS / cfg_.radiatorLagS;
+
+    const int64_t gain = (int64_t)cfg_.heatCdPerH * 10000 * radU_ / 1000000;             // 1e-6 °C per h
+    const int64_t loss = (roomU_ - outdoorU(tS)) * (int64_t)cfg_.lossPmPerH / 1000;        // 1e-6 °C per h
+    roomU_ += (gain - loss) * (int64_t)dtS / 3600;
+    return room();
+  }
+
+  cdeg_t room() const { return (cdeg_t)(roomU_ >= 0 ? (roomU_ + 5000) / 10000 : (roomU_ - 5000) / 10000); }
+
+  // What the firmware would read: DS18B20 1/16 °C steps, optional +/- noise, back to 0.01 °C
+  cdeg_t sensor()
+  {
+    int32_t raw = (int32_t)((roomU_ * 16 + (roomU_ >= 0 ? 500000 : -500000)) / 1000000);
+    if (cfg_.noiseRaw16)
+    {
+      lcg_ = lcg_ * 1103515245u + 12345u;
+      raw += (int32_t)((lcg_ >> 16) % (2u * cfg_.noiseRaw16 + 1)) - cfg_.noiseRaw16;
+    }
+    return cdeg_from_raw16((int16_t)raw);
+  }
+
+private:
+  PlantConfig cfg_;
+  int64_t roomU_;
+  int64_t radU_ = 0;
+  uint32_t lcg_ = 1;
+};
+
+static inline int16_t sim_setpoint(const SimSchedule &s, uint32_t tS)
+{
+  const uint32_t h = (tS % 86400) / 3600;
+  return (h >= s.dayStartH && h < s.dayEndH) ? s.dayCd : s.nightCd;
+}
+
+// Runs `days` simulated days in stepS increments. ctl(sensorCd, spCd, nowMs) -> heater command;
+// in sleep mode (sp <= 10.00 °C) the controller is skipped and the heater held OFF, like the
+// firmware. idle() is called once per simulated hour (progress output, or a no-op).
+template <typename Controller, typename Idle>
+SimReport sim_run(const PlantConfig &pc, const SimSchedule &sch, uint16_t days, uint16_t stepS,
+                  Controller ctl, Idle idle)
+{
+  SimReport r = {};
+  if (stepS == 0)
+    stepS = 1;
+  ThermalPlant plant(pc);
+  const uint32_t endS = (uint32_t)days * 86400UL;
+  uint64_t absErr = 0;
+  uint32_t cold = 0, onSteps = 0;
+  bool heater = false, settled = false, below = false;
+  int16_t lastSp = CDEG_INVALID;
+  cdeg_t room = plant.room();
+  r.minRoomCd = r.maxRoomCd = room;
+  r.maxOvershootCd = 0;
+
+  for (uint32_t t = 0; t < endS; t += stepS)
+  {
+    if (t % 3600 < stepS)
+      idle();
+    const int16_t sp = sim_setpoint(sch, t);
+    if (sp != lastSp)
+    {
+      settled = below = false;
+      lastSp = sp;
+    }
+    const bool sleeping = sp <= 1000;
+    // Controller time starts at 1 ms: 0 is the "unset" marker of several timers
+    const bool want = sleeping ? false : ctl(plant.sensor(), sp, (uint32_t)(t * 1000UL + 1));
+    if (want && !heater)
+      r.cycles++;
+    heater = want;
+    if (heater)
+      onSteps++;
+
+    room = plant.step(heater, stepS, t);
+    r.steps++;
+    if (room < r.minRoomCd)
+      r.minRoomCd = room;
+    if (room > r.maxRoomCd)
+      r.maxRoomCd = room;
+
+    if (!sleeping)
+    {
+      // Overshoot only counts once the room came up through sp: a setback is not an overshoot
+      if (room < sp)
+        below = true;
+      else if (below)
+        settled = true;
+      if (settled && room - sp > r.maxOvershootCd)
+        r.maxOvershootCd = (int16_t)(room - sp);
+    }
+    if (sp == sch.dayCd)
+    {
+      r.comfortSteps++;
+      absErr += (uint32_t)(room > sp ? room - sp : sp - room);
+      if (room < sp - 50)
+        cold++;
+    }
+  }
+
+  r.simS = endS;
+  if (r.comfortSteps)
+  {
+    r.comfortAbsErrCd = (uint32_t)(absErr / r.comfortSteps);
+    r.coldPermille = (uint16_t)((uint64_t)cold * 1000 / r.comfortSteps);
+  }
+  if (r.steps)
+    r.onPermille = (uint16_t)((uint64_t)onSteps * 1000 / r.steps);
+  if (endS)
+    r.cyclesPerHourX100 = (uint16_t)((uint64_t)r.cycles * 360000 / endS);
+  return r;
+}
+
+// The decision taskControl() makes for one zone: filtered reading -> strict hysteresis or TPI
+// (TPI windows raised to the output's minimum times) -> heater output with fail-safe OFF on no
+// reading or the hard cutoff. Call step() from sim_run()'s controller lambda.
+template <uint8_t N>
+struct SimControlLoop
+{
+  bool tpiMode;
+  TempFilterConfig filterCfg;
+  TpiConfig tpiCfg;
+  HeaterConfig heaterCfg;
+
+  TempFilter<N> filter;
+  TpiController tpi;
+  HeaterOutput output;
+  uint8_t action = 0;
+  uint32_t wantSteps = 0;      // controller asked for heat
+  uint32_t deliveredSteps = 0; // output stage drove the relay
+  uint32_t mismatchSteps = 0;  // the two differed: stretched/deferred by the minimum times
+  uint32_t cooldownSteps = 0;  // forced OFF by max ON (not counted as a mismatch)
+
+  SimControlLoop(bool tpi, const TempFilterConfig &f, const TpiConfig &t, const HeaterConfig &h)
+      : tpiMode(tpi), filterCfg(f), tpiCfg(tpi_effective(t, h.minOnMs, h.minOffMs)), heaterCfg(h) {}
+
+  bool step(cdeg_t sensor, cdeg_t sp, uint32_t nowMs)
+  {
+    const cdeg_t t = filter.push(sensor, filterCfg);
+    if (!cdeg_valid(t))
+      action = 0;
+    else if (tpiMode)
+      action = (tpi.update(t, sp, nowMs, tpiCfg) && t < HEAT_CUTOFF_CD) ? 1 : 0;
+    else
+      action = apply_hysteresis(t, sp, action);
+    const bool on = output.update(action == 1, !cdeg_valid(t) || t >= HEAT_CUTOFF_CD, nowMs, heaterCfg);
+    wantSteps += action == 1;
+    deliveredSteps += on;
+    if (output.state() == HS_COOLDOWN || output.event() == HE_RELEASED) // ON again next tick
+      cooldownSteps++;
+    else
+      mismatchSteps += on != (action == 1);
+    return on;
+  }
+};
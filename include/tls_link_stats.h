@@ -0,0 +1,59 @@
+// include/tls_link_stats.h — accounting for one long-lived TLS client (keep-alive + session cache)
+// - Each request is one of: sent on a kept-alive socket, a resumed handshake, a full handshake
+// - Resumption is judged from the session ID, as in TLS 1.2 (BearSSL has no tickets): the
+//   server echoes the cached ID to resume, and it hands out a new one (or none) for a full handshake
+// - No Arduino dependencies: the caller extracts the session IDs from its TLS stack
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+struct TlsSessionId
+{
+  uint8_t len; // 0 = none cached / not cacheable on the server
+  uint8_t id[32];
+};
+
+static inline bool tls_same_session(const TlsSessionId &a, const TlsSessionId &b)
+{
+  return a.len && a.len == b.len && memcmp(a.id, b.id, a.len) == 0;
+}
+
+class TlsLinkStats
+{
+public:
+  // One request. keptAlive: the socket was already open before it. connected: the server
+  // answered (any HTTP status), so a new connection completed its handshake. before/after:
+  // the cached session ID before the request and after it. ok: 200 with a body.
+  void record(bool keptAlive, bool connected, const TlsSessionId &before, const TlsSessionId &after, bool ok)
+  {
+    requests_++;
+    if (!keptAlive && connected)
+    {
+      handshakes_++;
+      if (tls_same_session(before, after))
+        resumed_++;
+    }
+    if (!ok)
+      fails_++;
+    else if (keptAlive)
+      reused_++;
+  }
+
+  uint32_t requests() const { return requests_; }
+  uint32_t fails() const { return fails_; }
+  uint32_t reused() const { return reused_; }         // sent on an open keep-alive socket
+  uint32_t handshakes() const { return handshakes_; } // new TLS connections
+  uint32_t resumed() const { return resumed_; }       // ...of which resumed the cached session
+  uint32_t fullHandshakes() const { return handshakes_ - resumed_; }
+  uint16_t resumePermille() const { return handshakes_ ? (uint16_t)((uint64_t)resumed_ * 1000 / handshakes_) : 0; }
+  uint16_t reusePermille() const { return requests_ ? (uint16_t)((uint64_t)reused_ * 1000 / requests_) : 0; }
+
+private:
+  uint32_t requests_ = 0;
+  uint32_t fails_ = 0;
+  uint32_t reused_ = 0;
+  uint32_t handshakes_ = 0;
+  uint32_t resumed_ = 0;
+};
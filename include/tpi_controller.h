@@ -0,0 +1,126 @@
+// include/tpi_controller.h — PI controller with time-proportional (TPI) heater output
+// - Error in 0.01 °C, duty in per-mille, integral kept as per-mille x 1024: integer only
+// - Anti-windup: conditional integration (no integrating further into a saturated output)
+//   plus a hard clamp of the integral to the 0..100 % duty range
+// - Output: ON for duty x cycleMs at the start of each cycle; the ON window can shrink
+//   mid-cycle when the duty drops (overshoot), never below minPulseMs once started nor into
+//   an OFF rest shorter than minPulseMs, and it never grows until the next cycle
+// - tpi_effective(): minPulseMs raised to the heater output's minimum ON/OFF times, so every
+//   window the controller asks for is one the output stage delivers unchanged
+// - No Arduino dependencies: the caller passes the clock in
+
+#pragma once
+
+#include <stdint.h>
+
+struct TpiConfig
+{
+  uint32_t cycleMs;    // TPI cycle length
+  uint16_t kpPmPerC;   // proportional gain: duty per-mille per °C of error
+  uint32_t tiMs;       // integral time (0 = P only)
+  uint32_t minPulseMs; // ON/OFF windows shorter than this are dropped / merged
+};
+
+// 10 min cycle, 2 °C proportional band, 30 min integral time, 1 min minimum pulse
+static const TpiConfig TPI_DEFAULTS = {600000UL, 500, 1800000UL, 60000UL};
+
+class TpiController
+{
+public:
+  // One control step; returns whether the heater should be ON now.
+  bool update(int16_t tempCd, int16_t spCd, uint32_t nowMs, const TpiConfig &cfg)
+  {
+    const int32_t e = (int32_t)spCd - tempCd;
+    uint32_t dt = started_ ? nowMs - lastMs_ : 0;
+    if (dt > MAX_DT_MS)
+      dt = MAX_DT_MS; // a stalled loop must not dump minutes of error into the integral
+    lastMs_ = nowMs;
+
+    p_ = (int32_t)cfg.kpPmPerC * e / 100;
+    if (cfg.tiMs && dt)
+    {
+      const int64_t di = (int64_t)cfg.kpPmPerC * e * dt * 1024 / (100LL * cfg.tiMs);
+      const int32_t u = p_ + (int32_t)(iAcc_ >> 10);
+      const bool windsUp = (u >= 1000 && di > 0) || (u <= 0 && di < 0);
+      if (!windsUp)
+        iAcc_ += di;
+      if (iAcc_ < 0)
+        iAcc_ = 0;
+      if (iAcc_ > (int64_t)1000 << 10)
+        iAcc_ = (int64_t)1000 << 10;
+    }
+    int32_t u = p_ + (int32_t)(iAcc_ >> 10);
+    duty_ = (uint16_t)(u < 0 ? 0 : (u > 1000 ? 1000 : u));
+
+    const uint32_t want = window(cfg);
+    if (!started_ || nowMs - cycleStart_ >= cfg.cycleMs)
+    {
+      started_ = true;
+      cycleStart_ = nowMs;
+      cycles_++;
+      onMs_ = want;
+    }
+    else if (want < onMs_)
+    {
+      uint32_t on = want < cfg.minPulseMs ? cfg.minPulseMs : want; // a started pulse runs its minimum
+      const uint32_t in = nowMs - cycleStart_;
+      if (on < in)
+        on = in;
+      if (cfg.cycleMs - on >= cfg.minPulseMs)
+        onMs_ = on; // else the OFF rest of the cycle would be too short: keep heating to the end
+    }
+    return nowMs - cycleStart_ < onMs_;
+  }
+
+  void reset()
+  {
+    started_ = false;
+    iAcc_ = 0;
+    p_ = 0;
+    duty_ = 0;
+    onMs_ = 0;
+  }
+
+  uint16_t dutyPermille() const { return duty_; }
+  int16_t pTermPermille() const { return (int16_t)(p_ < -32000 ? -32000 : (p_ > 32000 ? 32000 : p_)); }
+  int16_t iTermPermille() const { return (int16_t)(iAcc_ >> 10); }
+  uint32_t onMs() const { return onMs_; }
+  uint32_t cycleElapsedMs(uint32_t nowMs) const { return started_ ? nowMs - cycleStart_ : 0; }
+  uint32_t cycles() const { return cycles_; }
+
+private:
+  static const uint32_t MAX_DT_MS = 10000;
+
+  // ON time for the current duty, with sub-minimum ON or OFF windows snapped to 0 / full cycle
+  uint32_t window(const TpiConfig &cfg) const
+  {
+    uint32_t on = (uint32_t)((uint64_t)duty_ * cfg.cycleMs / 1000);
+    if (on < cfg.minPulseMs)
+      return 0;
+    if (cfg.cycleMs - on < cfg.minPulseMs)
+      return cfg.cycleMs;
+    return on;
+  }
+
+  bool started_ = false;
+  uint32_t lastMs_ = 0;
+  uint32_t cycleStart_ = 0;
+  uint32_t onMs_ = 0;
+  int32_t p_ = 0;
+  int64_t iAcc_ = 0; // per-mille x 1024
+  uint16_t duty_ = 0;
+  uint32_t cycles_ = 0;
+};
+
+// TPI tuning as run behind a heater output that holds ON for minOnMs and OFF for minOffMs
+// (heat_control.h): shorter windows would be stretched or deferred there, and the delivered
+// duty would drift from the computed one
+static inline TpiConfig tpi_effective(const TpiConfig &cfg, uint32_t minOnMs, uint32_t minOffMs)
+{
+  TpiConfig c = cfg;
+  if (c.minPulseMs < minOnMs)
+    c.minPulseMs = minOnMs;
+  if (c.minPulseMs < minOffMs)
+    c.minPulseMs = minOffMs;
+  return c;
+}
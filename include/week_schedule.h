@@ -0,0 +1,125 @@
+// include/week_schedule.h — compact local copy of the server weekly schedule (schedule.json)
+// - Slots flattened to (minute of week, setpoint) pairs, sorted, Monday = day 0; 4 bytes each
+// - Same rules as computeAutoSetpoint() in get_setpoint.php: a day without slots follows the
+//   manual setpoint; before a day's first slot, that first slot applies
+// - at(): binary search within the day's range, O(log n); nextChange(): forward scan of slot
+//   times and midnights, O(n) over at most MAX_SLOTS + 7 candidates
+// - No Arduino dependencies: the caller passes the local time in
+
+#pragma once
+
+#include <stdint.h>
+#include "centideg.h"
+
+struct WeekSlot
+{
+  uint16_t minute; // minute of week: day * 1440 + hh * 60 + mm
+  cdeg_t sp;
+};
+
+class WeekSchedule
+{
+public:
+  static const uint8_t MAX_SLOTS = 64;
+  static const uint16_t MIN_PER_DAY = 1440;
+  static const uint16_t MIN_PER_WEEK = 7 * 1440;
+
+  void clear(uint32_t version, cdeg_t manual)
+  {
+    count_ = 0;
+    version_ = version;
+    manual_ = manual;
+    for (uint8_t d = 0; d <= 7; ++d)
+      dayStart_[d] = 0;
+  }
+
+  // Append in (day, minute) order. False when full, out of order or out of range.
+  bool add(uint8_t day, uint16_t minuteOfDay, cdeg_t sp)
+  {
+    if (count_ >= MAX_SLOTS || day > 6 || minuteOfDay >= MIN_PER_DAY || !cdeg_valid(sp))
+      return false;
+    const uint16_t m = (uint16_t)(day * MIN_PER_DAY + minuteOfDay);
+    if (count_ && m < slots_[count_ - 1].minute)
+      return false;
+    slots_[count_].minute = m;
+    slots_[count_].sp = sp;
+    count_++;
+    for (uint8_t d = day + 1; d <= 7; ++d)
+      dayStart_[d] = count_; // days after `day` start past this slot
+    return true;
+  }
+
+  // Setpoint in force at minute-of-week m (always valid once loaded: manual as fallback)
+  cdeg_t at(uint16_t m) const
+  {
+    m %= MIN_PER_WEEK;
+    const uint8_t day = (uint8_t)(m / MIN_PER_DAY);
+    uint8_t lo = dayStart_[day];
+    const uint8_t first = lo;
+    uint8_t hi = dayStart_[day + 1];
+    if (lo == hi)
+      return manual_;
+    // last slot with minute <= m in [first, hi)
+    while (lo < hi)
+    {
+      const uint8_t mid = (uint8_t)((lo + hi) / 2);
+      if (slots_[mid].minute <= m)
+        lo = (uint8_t)(mid + 1);
+      else
+        hi = mid;
+    }
+    return slots_[lo > first ? lo - 1 : first].sp;
+  }
+
+  // First minute after m (within a week) where the setpoint differs from at(m).
+  // Returns false when the program never changes.
+  bool nextChange(uint16_t m, uint16_t &inMin, cdeg_t &sp) const
+  {
+    m %= MIN_PER_WEEK;
+    const cdeg_t cur = at(m);
+    const uint8_t day0 = (uint8_t)(m / MIN_PER_DAY);
+    const uint16_t dayMin = (uint16_t)(m % MIN_PER_DAY);
+    for (uint8_t k = 0; k <= 7; ++k)
+    {
+      const uint8_t day = (uint8_t)((day0 + k) % 7);
+      const uint16_t base = (uint16_t)(k * MIN_PER_DAY - dayMin); // minutes from m to this midnight
+      if (k && check(base, m, cur, inMin, sp))
+        return true;
+      for (uint8_t i = dayStart_[day]; i < dayStart_[day + 1]; ++i)
+      {
+        const uint16_t off = (uint16_t)(base + slots_[i].minute % MIN_PER_DAY);
+        if ((k || slots_[i].minute % MIN_PER_DAY > dayMin) && check(off, m, cur, inMin, sp))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  uint8_t count() const { return count_; }
+  const WeekSlot &slot(uint8_t i) const { return slots_[i]; }
+  uint32_t version() const { return version_; }
+  cdeg_t manual() const { return manual_; }
+
+private:
+  bool check(uint16_t off, uint16_t m, cdeg_t cur, uint16_t &inMin, cdeg_t &sp) const
+  {
+    const cdeg_t v = at((uint16_t)((m + off) % MIN_PER_WEEK));
+    if (v == cur)
+      return false;
+    inMin = off;
+    sp = v;
+    return true;
+  }
+
+  WeekSlot slots_[MAX_SLOTS] = {};
+  uint8_t dayStart_[8] = {}; // slots of day d: [dayStart_[d], dayStart_[d + 1])
+  uint8_t count_ = 0;
+  uint32_t version_ = 0;
+  cdeg_t manual_ = CDEG_INVALID;
+};
+
+// Local time -> minute of week (Monday = day 0, as in get_setpoint.php)
+static inline uint16_t week_minute(int tmWday, int tmHour, int tmMin)
+{
+  return (uint16_t)(((tmWday + 6) % 7) * 1440 + tmHour * 60 + tmMin);
+}
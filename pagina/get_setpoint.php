@@ -4,7 +4,15 @@
 // - Optional ?cald=0|1 updates state.json.cald (relay status)
 // - Reads/Writes state.json from the same directory as this script
 // - Also logs temperature to temp_history.csv if last modification > 10 minutes
-// - Returns JSON: { ok, mode, setpoint, actualTemp, actualTemp_str, cald, date, time, timezone }
+// - Returns JSON: { ok, mode, setpoint, next_setpoint, next_change_s, actualTemp, actualTemp_str, cald,
+//   date, time, timezone }
+// - next_setpoint / next_change_s: next scheduled setpoint change (AUTO only, else null) so the
+//   thermostat can start heating ahead of it
+// - schedule_version: 8 hex digits over schedule.json + manualSetpoint. A thermostat that sends
+//   ?sv=<its version> keeps a local copy and evaluates it itself: when sv matches, AUTO mode
+//   returns setpoint/next_* = null and skips computeAutoSetpoint entirely
+// - ?schedule=1 returns only the compact program for that local copy:
+//   { ok, version, manual, days: [[[minuteOfDay, setpoint], ...] x 7, Monday first] }
 
 header('Content-Type: application/json; charset=utf-8');
 header('Access-Control-Allow-Origin: *'); // allow microcontrollers / other origins
@@ -59,9 +67,9 @@ function hmToMinutes($hm)
     return $h * 60 + $m;
 }
 
-function computeAutoSetpoint($schedule, $manualSetpoint)
+function computeAutoSetpoint($schedule, $manualSetpoint, ?DateTime $at = null)
 {
-    $now = new DateTime();
+    $now = $at ?? new DateTime();
     $dayIndex = ((int) $now->format('w') + 6) % 7; // Monday=0
     if (!isset($schedule[$dayIndex]['slots']) || !is_array($schedule[$dayIndex]['slots']) || !count($schedule[$dayIndex]['slots'])) {
         return (float) $manualSetpoint;
@@ -77,6 +85,48 @@ function computeAutoSetpoint($schedule, $manualSetpoint)
     return isset($chosen['setpoint']) ? (float) $chosen['setpoint'] : (float) $manualSetpoint;
 }
 
+/**
+ * First instant within the next 7 days where the AUTO setpoint differs from $current.
+ * Candidates are every slot time and every midnight (a day's first slot also covers its early hours).
+ * Returns ['setpoint' => float, 'in_s' => int] or null when the schedule never changes.
+ */
+function computeNextChange($schedule, $manualSetpoint, $current)
+{
+    $now = new DateTime();
+    $candidates = [];
+    for ($d = 0; $d <= 7; $d++) {
+        $day = (clone $now)->setTime(0, 0)->modify("+$d day");
+        if ($d > 0)
+            $candidates[] = clone $day;
+        $dayIndex = ((int) $day->format('w') + 6) % 7;
+        $slots = $schedule[$dayIndex]['slots'] ?? [];
+        if (!is_array($slots))
+            continue;
+        foreach ($slots as $s) {
+            if (!isset($s['time']))
+                continue;
+            $m = hmToMinutes($s['time']);
+            $candidates[] = (clone $day)->setTime(intdiv($m, 60), $m % 60);
+        }
+    }
+    usort($candidates, fn($a, $b) => $a <=> $b);
+    foreach ($candidates as $t) {
+        if ($t <= $now)
+            continue;
+        $sp = computeAutoSetpoint($schedule, $manualSetpoint, $t);
+        if ($sp != (float) $current)
+            return ['setpoint' => $sp, 'in_s' => $t->getTimestamp() - $now->getTimestamp()];
+    }
+    return null;
+}
+
+// Changes whenever the program or its fallback (manual setpoint) does
+function schedule_version($scheduleFile, $manualSetpoint)
+{
+    $raw = is_readable($scheduleFile) ? (string) @file_get_contents($scheduleFile) : '';
+    return sprintf('%08x', crc32($raw . '|' . one_decimal_str($manualSetpoint)));
+}
+
 function one_decimal_str($n)
 {
     return number_format((float) $n, 1, '.', '');
@@ -129,6 +179,31 @@ $schedule = isset($scheduleWrap['schedule']) && is_array($scheduleWrap['schedule
 
 $mode = $state['mode'] ?? 'AUTO';
 $manualSetpoint = isset($state['manualSetpoint']) ? (float) $state['manualSetpoint'] : 20.0;
+$scheduleVersion = schedule_version($scheduleFile, $manualSetpoint);
+
+// ---------- compact program for the thermostat's local schedule (read-only) ----------
+if (isset($_GET['schedule'])) {
+    $days = [];
+    for ($d = 0; $d < 7; $d++) {
+        $slots = $schedule[$d]['slots'] ?? [];
+        $out = [];
+        if (is_array($slots)) {
+            foreach ($slots as $s) {
+                if (isset($s['time'], $s['setpoint']))
+                    $out[] = [hmToMinutes($s['time']), (float) $s['setpoint']];
+            }
+        }
+        usort($out, fn($a, $b) => $a[0] <=> $b[0]);
+        $days[] = $out;
+    }
+    echo json_encode([
+        'ok' => true,
+        'version' => $scheduleVersion,
+        'manual' => $manualSetpoint,
+        'days' => $days
+    ], JSON_UNESCAPED_SLASHES);
+    exit;
+}
 $actualTemp = isset($state['actualTemp']) ? round((float) $state['actualTemp'], 1) : null;
 $cald = isset($state['cald']) ? (int) $state['cald'] : 0;
 
@@ -167,9 +242,12 @@ if ($mode === 'OFF') {
     $setpoint = null;
 } elseif ($mode === 'ON') {
     $setpoint = $manualSetpoint;
+} elseif (($_GET['sv'] ?? '') === $scheduleVersion) { // AUTO, evaluated on the thermostat
+    $setpoint = null;
 } else { // AUTO
     $setpoint = computeAutoSetpoint($schedule, $manualSetpoint);
 }
+$next = ($mode !== 'OFF' && $mode !== 'ON' && $setpoint !== null) ? computeNextChange($schedule, $manualSetpoint, $setpoint) : null;
 
 // ---------- normalize numbers for output ----------
 $actualTemp_num = ($actualTemp !== null) ? (float) one_decimal_str($actualTemp) : null;
@@ -181,6 +259,9 @@ echo json_encode([
     'ok' => true,
     'mode' => $mode,
     'setpoint' => $setpoint,
+    'next_setpoint' => $next ? $next['setpoint'] : null,
+    'next_change_s' => $next ? $next['in_s'] : null,
+    'schedule_version' => $scheduleVersion,
     'actualTemp' => $actualTemp_num,
     'actualTemp_str' => $actualTemp_str,
     'cald' => $cald,
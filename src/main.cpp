@@ -5,8 +5,9 @@
 // - Control logic: 0.5°C hysteresis (ON <= sp-0.25, OFF >= sp+0.25)
 // - OTA: Upload via PlatformIO using mDNS (esp-thermo.local) or device IP.
 // - Remote setpoint: fetch via get_setpoint.php; adopt & persist only if changed.
-// - ESP-NOW payload: only {"heater":"ON"} or {"heater":"OFF"}
+// - ESP-NOW payload: binary frame (include/espnow_frame.h); JSON {"heater":"ON"|"OFF"} kept for legacy relays
 // - Use ACK from relay to show Heat ON/OFF in UI and to set cald=0/1 in HTTP
+// - Zones: up to 10 sensor+setpoint+relay sets ("/api/zones", LittleFS /zones.bin); zone 0 = UI/remote zone
 // - *** Performance: non-blocking DS18B20, skip HTTPS in AP mode, tight timeouts, AP keeps radio awake.
 
 #include <Arduino.h>
@@ -14,7 +15,6 @@
 #include <espnow.h>
 #include <ArduinoJson.h>
 #include <OneWire.h>
-#include <DallasTemperature.h>
 #include <LittleFS.h>
 #include <ESP8266WebServer.h>
 #include <ESP8266mDNS.h>
@@ -24,6 +24,21 @@
 #include <WiFiClientSecureBearSSL.h>
 #include <math.h>
 
+#include "espnow_frame.h"
+#include "spsc_ring.h"
+#include "espnow_stats.h"
+#include "espnow_arq.h"
+#include "ds18b20.h"
+#include "centideg.h"
+#include "temp_filter.h"
+#include "tpi_controller.h"
+#include "heat_control.h"
+#include "heat_rate.h"
+#include "week_schedule.h"
+#include "coop_sched.h"
+#include "report_policy.h"
+#include "tls_link_stats.h"
+
 extern "C"
 {
 #include "user_interface.h"
@@ -45,6 +60,17 @@ static const char *OTA_PASS = ""; // e.g. "mySecret123"
 static String g_wifiSsid;
 static String g_wifiPass;
 
+// ===== Remote "cesana" server (HTTPS) =====
+// Point at the local HTTPS stand-in (tools/cesana_standin.py) with e.g.
+// -DCESANA_HOST=\"192.168.1.50\" -DCESANA_PORT=8443 (certificate not checked: setInsecure())
+#ifndef CESANA_HOST
+#define CESANA_HOST "cesana.steplab.net"
+#endif
+#ifndef CESANA_PORT
+#define CESANA_PORT 443
+#endif
+#define CESANA_PATH "/get_setpoint.php"
+
 // ===== Timezone / NTP (Europe/Rome) =====
 static const char *TZ_INFO = "CET-1CEST,M3.5.0,M10.5.0/3";
 static const char *NTP_1 = "pool.ntp.org";
@@ -53,44 +79,259 @@ static const char *NTP_2 = "time.google.com";
 // ===== DS18B20 on D4 =====
 #define ONE_WIRE_BUS D4
 OneWire oneWire(ONE_WIRE_BUS);
-DallasTemperature sensors(&oneWire);
-DeviceAddress g_dsAddr{};
-bool g_haveSensor = false;  // any device present
-bool g_haveAddress = false; // address for index 0 resolved
+Ds18b20<OneWire> g_ds(oneWire);
+bool g_haveSensor = false; // any device present
+
+// --- Per-sensor filter: spike rejection (median window) + fixed-point EMA, see temp_filter.h ---
+// Build with -DTEMP_FILTER_N=1 -DTEMP_FILTER_EMA_SHIFT=0 to feed raw readings to the control loop.
+#ifndef TEMP_FILTER_N
+#define TEMP_FILTER_N 5 // median window (odd)
+#endif
+#ifndef TEMP_FILTER_SPIKE_CD
+#define TEMP_FILTER_SPIKE_CD 150 // 1.5 °C from the median in one sample = glitch
+#endif
+#ifndef TEMP_FILTER_EMA_SHIFT
+#define TEMP_FILTER_EMA_SHIFT 2 // alpha 1/4
+#endif
+static const TempFilterConfig g_filterCfg = {TEMP_FILTER_SPIKE_CD, TEMP_FILTER_EMA_SHIFT};
+
+// --- Sensor table: every DS18B20 seen on the bus, labels persisted in /sensors.json ---
+// Append-only order (index = bit in a zone's sensor mask); absent sensors can be forgotten.
+static const uint8_t MAX_SENSORS = 8;
+// Alarm mode (opt-in, off by default; no low-power mode turns it on): TH/TL per sensor from the
+// zones' thresholds, one conversion + Alarm Search every DS_ALARM_CONVERT_MS. Between searches it
+// skips the per-ROM scratchpad reads of sensors that are not alarming; all are read every
+// DS_ALARM_FULL_READ_MS (and on every conversion under TPI). Nothing else sleeps or slows down.
+#ifndef DS_ALARM_MODE
+#define DS_ALARM_MODE 0
+#endif
+static const uint32_t DS_ALARM_CONVERT_MS = 2000;
+static const uint32_t DS_ALARM_FULL_READ_MS = 60000;
+// older readings are left out of zone aggregates
+static const uint32_t DS_STALE_MS = DS_ALARM_MODE ? DS_ALARM_FULL_READ_MS + 5000 : 5000;
+struct DsSensor
+{
+  uint8_t rom[8];
+  char label[16];
+  bool present;    // seen in the last bus search
+  cdeg_t temp;     // filtered value fed to the zones
+  cdeg_t rawTemp;  // last CRC-valid reading, before the filter
+  uint32_t readMs; // sample timestamp (end of its conversion) of the last accepted reading
+  uint8_t misses;  // failed reads in a row
+  uint8_t resolution;   // config byte of its last scratchpad
+  uint16_t crcErrors;   // per-ROM diagnostics for /api/owbus
+  uint16_t readErrors;  // no presence / no data
+  int8_t alarmTh;       // TH/TL programmed in alarm mode
+  int8_t alarmTl;
+  bool alarmSet;        // programmed under the driver's current configGen
+  uint16_t alarmGen;
+  TempFilter<TEMP_FILTER_N> filter;
+};
+static DsSensor g_sensors[MAX_SENSORS];
+static uint8_t g_sensorCount = 0;
 
 // --- DS18B20 async conversion state (non-blocking) ---
 static uint32_t g_dsReqAt = 0;
 static bool g_dsPending = false;
+// Adaptive resolution + effective sample rate (10 s window)
+static uint32_t g_dsResChanges = 0;
+static uint32_t g_dsSamples = 0;
+static uint32_t g_dsRateWinStartMs = 0;
+static uint32_t g_dsRateWinSamples = 0;
+static float g_dsRateHz = 0;
+
+// Pipelined sampler: next conversion starts right after the reads; every sample is stamped
+// with the end of its conversion (millis(), wrap-safe differences)
+struct MsStat
+{
+  uint32_t last = 0, max = 0, avgX16 = 0, n = 0; // avg: EWMA 1/16, fixed point x16
+  void add(uint32_t ms)
+  {
+    last = ms;
+    if (ms > max)
+      max = ms;
+    avgX16 = n++ ? avgX16 + (int32_t)(ms * 16 - avgX16) / 16 : ms * 16;
+  }
+  uint32_t avg() const { return (avgX16 + 8) / 16; }
+};
+static uint32_t g_dsSampleAtMs = 0;   // newest sample timestamp
+static uint32_t g_dsKickRetryAt = 0;  // convert failed (no presence) -> retry after this
+static MsStat g_dsJitter;             // |sample period - tCONV|
+static MsStat g_dsAgeAtDecision;      // sample age when the hysteresis used it
+static uint8_t g_dsKickFails = 0;     // consecutive converts without presence pulse
+static uint32_t g_dsFullReadAt = 0;   // alarm mode: last round that read every sensor
+
+// Hot-plug scanner: ROM searches with exponential backoff while something is missing, a slow
+// discovery rescan otherwise, and a token bucket capping search time on the bus
+static const uint32_t HP_BACKOFF_MIN_MS = 250;
+static const uint32_t HP_BACKOFF_MAX_MS = 30000;
+static const uint32_t HP_DISCOVER_MS = 60000;      // all known sensors present: look for new ones
+static const uint32_t HP_BUDGET_US_PER_MS = 30;    // 30 ms of search per second (3 %)
+static const int32_t HP_BUDGET_CAP_US = 60000;     // burst: two typical single-sensor searches
+static const uint8_t DS_MISS_LIMIT = 3;            // failed reads in a row -> sensor gone
+static uint32_t g_hpBackoffMs = HP_BACKOFF_MIN_MS;
+static uint32_t g_hpNextMs = 0;
+static int32_t g_hpTokensUs = HP_BUDGET_CAP_US;
+static uint32_t g_hpRefillMs = 0;
+static uint32_t g_hpLastCostUs = 15000; // estimate until the first search is timed
+static uint32_t g_hpScans = 0;
+static uint32_t g_hpLastScanMs = 0;
+static uint32_t g_hpBudgetSkips = 0;
+static uint32_t g_hpUsTotal = 0;
+static uint32_t g_dsAppeared = 0;
+static uint32_t g_dsLost = 0;
+
+// ===== ESP-NOW peers: broadcast for discovery, unicast once a zone's relay is paired =====
+static uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static uint8_t g_espnowChannel = 1;
+static uint32_t g_txStatusOk = 0;
+static uint32_t g_txStatusErr = 0;
+
+// ===== ESP-NOW RX queue: callback copies raw frames, loop() decodes =====
+static const uint8_t ESPNOW_RX_MAX = 64; // ACKs are 9 B binary / ~40 B JSON
+struct EspnowRx
+{
+  uint32_t atMs;
+  uint8_t mac[6];
+  uint8_t len;
+  uint8_t data[ESPNOW_RX_MAX];
+};
+static SpscRing<EspnowRx, 8> g_rxRing;
+static uint32_t g_rxFrames = 0;   // accepted into the queue (written by callback only)
+static uint32_t g_rxOversize = 0; // dropped: longer than ESPNOW_RX_MAX
 
-// ===== ESP-NOW target (broadcast by default) =====
-static uint8_t TARGET[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+// Send-status callbacks are queued the same way (MAC-layer delivery feeds link quality)
+struct EspnowTxStatus
+{
+  uint8_t mac[6];
+  uint8_t status;
+};
+static SpscRing<EspnowTxStatus, 8> g_txStatusRing;
+
+// ===== ACK correlation: relay echoes the command seq =====
+static const uint32_t ACK_TIMEOUT_MS = 1000; // no ACK within this -> counted lost
+static InflightTable<ESPNOW_INFLIGHT_SLOTS> g_inflight; // sized for every zone's command + retries
+static RttHistogram g_rtt;
+static uint32_t g_ackUncorrelated = 0; // legacy JSON ACKs without "seq"
+
+// ===== ESP-NOW wire format =====
+// JSON compat: keep sending {"heater":..} until the relay answers with a binary ACK,
+// then switch TX to binary frames. Build with -DESPNOW_JSON_COMPAT=0 to go binary from boot.
+#ifndef ESPNOW_JSON_COMPAT
+#define ESPNOW_JSON_COMPAT 1
+#endif
+static bool g_txBinary = !ESPNOW_JSON_COMPAT;
+static uint16_t g_txSeq = 0;
 
 // ===== Fixed setpoint state (persisted) =====
-static float g_fixedSetpoint = 19.0f; // default: "on" preset
+static cdeg_t g_fixedSetpoint = 1900; // 0.01 °C, default: "on" preset
 static String g_fixedPreset = "on";   // "off" | "on" | "away" | "custom" | "remote"
 static bool g_fixedEnabled = true;    // always use fixed setpoint for control
 
-// ===== Live telemetry for web UI =====
-volatile float g_lastTempC = NAN;
-volatile uint8_t g_lastAction = 0; // local decision: 1=heat ON, 0=OFF
-
-// ===== ACK state from relay (drives UI + HTTP cald) =====
-static bool g_haveAck = false;
-static bool g_ackRelayOn = false;
-static uint32_t g_ackLastMs = 0;
+// ===== Zones: sensor + setpoint + hysteresis + relay per zone (persisted in /zones.bin) =====
+// Zone 0 is the main zone: its setpoint is g_fixedSetpoint (UI presets / remote), it drives
+// the top-level /api/status fields and the cesana report.
+static const uint8_t MAX_ZONES = ESPNOW_MAX_ZONES; // g_inflight is sized for this many
+static const uint8_t LEGACY_RELAY_ID = 12; // indirizzo della caldaia (zone 0 default)
+struct Zone
+{
+  // --- persisted ---
+  bool used;
+  bool paired;
+  uint8_t relayId;      // "id" / frame zone byte the relay answers to
+  uint8_t relayMac[6];  // learned from the first ACK
+  uint8_t sensorRom[8]; // control sensor; all zero -> first present sensor on the bus
+  uint8_t sensorAgg;    // ZoneAgg: control sensor / min / mean
+  uint8_t sensorMask;   // min/mean over these sensor-table bits; 0 -> every present sensor
+  cdeg_t setpoint;      // 0.01 °C, ignored for zone 0 (g_fixedSetpoint)
+  // --- live ---
+  cdeg_t temp;          // 0.01 °C, CDEG_INVALID until the first reading
+  uint32_t tempAtMs;    // timestamp of the sample behind temp
+  uint8_t action; // hysteresis decision: 1=heat ON, 0=OFF
+  bool haveAck;
+  bool ackRelayOn;
+  uint32_t ackLastMs;
+  // --- command path (after the heater output state machine) ---
+  bool heaterOn;
+  bool cmdSentOnce;
+  uint32_t cmdLastTxMs;
+  bool cmdAwaitAck;
+  uint32_t cmdChangeAtMs;
+  ArqTimer arq;     // retries for an unacknowledged state change
+  LinkQuality link; // EWMA of send status + ACK arrival; down -> fail-safe OFF
+  bool chLost;         // channel manager: link lost (down, or the radio channel moved), not yet recovered
+  uint32_t chLostAtMs; // ...since
+  TpiController tpi; // PI + time-proportional output (controller mode "tpi")
+  // --- heater output: min ON/OFF, 1 h max ON -> 30 min cooldown ---
+  HeaterOutput out;
+  HeatRateLearner learn; // heating/cooling rates from the sample stream (optimal start)
+};
+static Zone g_zones[MAX_ZONES];
+enum ZoneAgg : uint8_t
+{
+  ZA_CONTROL = 0, // sensorRom only
+  ZA_MIN,
+  ZA_MEAN,
+};
+static uint8_t g_zoneLearnPending = 0xFF; // zone whose relay MAC was just learned (handled in loop())
+static uint8_t g_zoneLearnMac[6] = {0};
 
-// ===== Hysteresis (°C, total band) =====
-static const float HYST_BAND_C = 0.5f; // +/- 0.25°C around setpoint
+// ===== Controller selection (persisted in /control.json) =====
+// "hysteresis" (default): strict bang-bang above. "tpi": PI duty cycle over cycleMs per zone.
+enum CtlMode : uint8_t
+{
+  CTL_HYSTERESIS = 0,
+  CTL_TPI,
+};
+static uint8_t g_ctlMode = CTL_HYSTERESIS;
+static TpiConfig g_tpiCfg = TPI_DEFAULTS;
+static HeaterConfig g_heaterCfg = HEATER_DEFAULTS; // anti-short-cycle timings
+static const char *ctlModeName(uint8_t m) { return m == CTL_TPI ? "tpi" : "hysteresis"; }
+// TPI as it runs: pulses no shorter than the heater output's minimum ON/OFF times
+static TpiConfig tpiRunConfig() { return tpi_effective(g_tpiCfg, g_heaterCfg.minOnMs, g_heaterCfg.minOffMs); }
+static const char *heaterStateName(uint8_t s) { return s == HS_ON ? "on" : (s == HS_COOLDOWN ? "cooldown" : "off"); }
 
 // ===== Remote "cesana" reporting (HTTPS GET) =====
 static uint32_t g_lastHttpMs = 0;
-static const uint32_t HTTP_MIN_INTERVAL_MS = 1500;
+static const uint32_t HTTP_MIN_INTERVAL_MS = 1500; // report task cadence: decides, rarely sends
+static ReportConfig g_reportCfg = REPORT_DEFAULTS; // delta / heartbeat / pull (in /control.json)
+static ReportPolicy g_report;
 static bool g_remoteOk = false;
-static float g_remoteSetpoint = NAN;
+static cdeg_t g_remoteSetpoint = CDEG_INVALID;
 static String g_remoteMode = "";
-static float g_remoteActual = NAN;
+static cdeg_t g_remoteActual = CDEG_INVALID;
 static bool g_remoteHeating = false;
-static float g_remoteDelta = NAN;
+static cdeg_t g_remoteDelta = CDEG_INVALID;
+static cdeg_t g_remoteNextSp = CDEG_INVALID; // next scheduled setpoint change (server or local program)
+static uint32_t g_remoteNextAtMs = 0;        // millis() when it takes effect
+static uint32_t g_remoteNextFetchMs = 0;     // when the above was received
+
+// ===== Local weekly schedule (mirror of the server program, persisted in /schedule.bin) =====
+// Followed while the server mode is AUTO: keeps the program running through internet outages.
+// Re-synced only when the schedule_version announced by the server changes.
+static WeekSchedule g_sched;
+static bool g_schedLoaded = false;
+static bool g_schedFollow = false;         // last known server mode was AUTO
+static uint32_t g_schedRemoteVer = 0;      // schedule_version from the last poll
+static bool g_schedRemoteVerKnown = false; // false after boot until the server answers
+static uint32_t g_schedSyncAtMs = 0;       // next sync attempt (after a failure)
+static uint32_t g_schedSyncs = 0;
+static uint32_t g_schedSyncFails = 0;
+static cdeg_t g_schedSetpoint = CDEG_INVALID; // what the local program says right now
+static const uint32_t SCHED_RETRY_MS = 60000;
+
+// ===== Optimal start (zone 0): heat ahead of the next scheduled setpoint =====
+static const uint32_t PREHEAT_MAX_MS = 3UL * 3600000UL;  // never start more than 3 h early
+static const uint32_t PREHEAT_FRESH_MS = 15UL * 60000UL; // schedule info older than this is ignored
+static const uint32_t PREHEAT_GRACE_MS = 5UL * 60000UL;  // hold the target this long past the change time
+static bool g_preheatActive = false;
+static uint32_t g_preheatLeadMs = 0;
+static uint32_t g_preheatStarts = 0;
+
+// ===== Learned heating/cooling rates (persisted in /heatrate.bin) =====
+static const uint32_t HEATRATE_SAVE_MIN_MS = 30UL * 60000UL; // flash wear: one write per 30 min max
+static bool g_heatRateDirty = false;
+static uint32_t g_heatRateSavedMs = 0;
 static bool g_apActive = false;
 
 // ===== Web server =====
@@ -101,10 +342,14 @@ static bool g_pendingRestart = false;
 static uint32_t g_restartAtMs = 0;
 
 // ===== Persist/write minimization for fixed setpoint =====
-static float g_lastSavedSetpoint = NAN;
+static cdeg_t g_lastSavedSetpoint = CDEG_INVALID;
 static uint32_t g_lastFsWriteMs = 0;
 static const uint32_t FS_WRITE_MIN_GAP_MS = 30000; // 30s between FS writes
-static const float SP_EPS = 0.05f;                 // consider same within ±0.05°C
+static const cdeg_t SP_EPS_CD = 5;                 // consider same within ±0.05°C
+
+static const char *AP_SSID = "Termometro";
+static const char *AP_PASS = "12345678";
+static uint8_t g_apChannel = 1; // moved to the relay's channel once a scan finds it
 
 static void startApFallback()
 {
@@ -112,14 +357,12 @@ static void startApFallback()
     return; // already running
   WiFi.mode(WIFI_AP_STA);
   wifi_set_sleep_type(NONE_SLEEP_T); // keep AP responsive
-  const char *apSsid = "Termometro";
-  const char *apPass = "12345678";
-  bool ok = WiFi.softAP(apSsid, apPass, /*channel*/ 1);
+  bool ok = WiFi.softAP(AP_SSID, AP_PASS, g_apChannel);
   g_apActive = ok;
   Serial.printf("[WiFi] AP fallback %s (SSID=%s, ch=%d, IP=%s)\n",
-                ok ? "started" : "FAILED", apSsid, 1, WiFi.softAPIP().toString().c_str());
-  // Keep ESP-NOW on the same channel as AP
-  wifi_set_channel(1);
+                ok ? "started" : "FAILED", AP_SSID, g_apChannel, WiFi.softAPIP().toString().c_str());
+  // Keep ESP-NOW on the same channel as AP (channel manager re-registers peers)
+  wifi_set_channel(g_apChannel);
 }
 
 // ===== Utils =====
@@ -135,19 +378,249 @@ static void printMac(const uint8_t *mac)
   }
 }
 
+static void formatMac(const uint8_t *mac, char *out /* >= 18 */)
+{
+  sprintf(out, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+// "AA:BB:..." -> n bytes (MACs: 6, 1-Wire ROMs: 8)
+static bool parseHexBytes(const char *s, uint8_t *out, uint8_t n)
+{
+  if (!s)
+    return false;
+  for (uint8_t i = 0; i < n; ++i)
+  {
+    char *end;
+    unsigned long v = strtoul(s, &end, 16);
+    if (end == s || v > 0xFF || (i < n - 1 ? *end != ':' : *end != '\0'))
+      return false;
+    out[i] = (uint8_t)v;
+    s = end + 1;
+  }
+  return true;
+}
+
+static bool parseMac(const char *s, uint8_t *mac) { return parseHexBytes(s, mac, 6); }
+
+static void formatRom(const uint8_t *rom, char *out /* >= 24 */)
+{
+  int p = 0;
+  for (int k = 0; k < 8; k++)
+    p += sprintf(out + p, "%02X%s", rom[k], (k < 7 ? ":" : ""));
+}
+
+// Unicast sends report real MAC-layer delivery; broadcast is always "OK"
 static void onDataSent(uint8_t *mac, uint8_t status)
 {
-  Serial.print("[TX] Sent to ");
-  printMac(mac);
-  Serial.print(" -> status=");
-  Serial.println(status == 0 ? "OK" : "ERR");
+  if (status == 0)
+    g_txStatusOk++;
+  else
+    g_txStatusErr++;
+  EspnowTxStatus st;
+  memcpy(st.mac, mac, 6);
+  st.status = status;
+  g_txStatusRing.push(st);
+}
+
+static bool zoneRomIsPrimary(const Zone &z)
+{
+  for (uint8_t i = 0; i < 8; ++i)
+    if (z.sensorRom[i])
+      return false;
+  return true;
+}
+
+static int8_t sensorByRom(const uint8_t *rom)
+{
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+    if (memcmp(g_sensors[i].rom, rom, 8) == 0)
+      return (int8_t)i;
+  return -1;
+}
+
+static int8_t sensorPrimary()
+{
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+    if (g_sensors[i].present)
+      return (int8_t)i;
+  return -1;
+}
+
+static uint8_t ds_present_count()
+{
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+    n += g_sensors[i].present ? 1 : 0;
+  return n;
+}
+
+static bool sensorFresh(uint8_t si, uint32_t now)
+{
+  const DsSensor &s = g_sensors[si];
+  return s.present && cdeg_valid(s.temp) && now - s.readMs < DS_STALE_MS;
+}
+
+static const char *zoneAggName(uint8_t a) { return a == ZA_MIN ? "min" : (a == ZA_MEAN ? "mean" : "control"); }
+
+// Zone temperature from the sensor table: control sensor, or min/mean over the zone's mask
+static cdeg_t zoneSensorTemp(const Zone &z, uint32_t now)
+{
+  if (z.sensorAgg == ZA_CONTROL)
+  {
+    int8_t si = zoneRomIsPrimary(z) ? sensorPrimary() : sensorByRom(z.sensorRom);
+    return (si >= 0 && sensorFresh((uint8_t)si, now)) ? g_sensors[si].temp : CDEG_INVALID;
+  }
+  int32_t sum = 0;
+  uint8_t n = 0;
+  cdeg_t mn = INT16_MAX;
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+  {
+    if ((z.sensorMask && !(z.sensorMask & (1u << i))) || !sensorFresh(i, now))
+      continue;
+    cdeg_t t = g_sensors[i].temp;
+    sum += t;
+    n++;
+    if (t < mn)
+      mn = t;
+  }
+  if (!n)
+    return CDEG_INVALID;
+  if (z.sensorAgg == ZA_MIN)
+    return mn;
+  return (cdeg_t)((sum >= 0 ? sum + n / 2 : sum - n / 2) / n);
+}
+
+static int8_t zoneByRelayId(uint8_t id)
+{
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    if (g_zones[i].used && g_zones[i].relayId == id)
+      return (int8_t)i;
+  return -1;
+}
+
+static int8_t zoneByMac(const uint8_t *mac)
+{
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    if (g_zones[i].used && g_zones[i].paired && memcmp(g_zones[i].relayMac, mac, 6) == 0)
+      return (int8_t)i;
+  return -1;
+}
+
+static void cmdNoteAck(Zone &z, bool relayOn, uint32_t atMs);
+static void chMarkLinkLost(Zone &z, uint32_t now);
+
+// One delivery outcome for a zone; a link judged down puts the zone in fail-safe (heater OFF)
+static void linkSample(Zone &z, bool ok)
+{
+  if (!z.link.sample(ok))
+    return;
+  uint8_t zi = (uint8_t)(&z - g_zones);
+  if (z.link.down())
+  {
+    z.arq.stop(); // stop flooding; heartbeats keep probing
+    chMarkLinkLost(z, millis()); // recovery is timed from here, not from every tick spent down
+    Serial.printf("[LINK] Zone %u link DOWN (q=%d) -> fail-safe OFF\n", zi, z.link.permille());
+  }
+  else
+  {
+    Serial.printf("[LINK] Zone %u link UP (q=%d)\n", zi, z.link.permille());
+  }
+}
+
+static void chNoteAck(Zone &z, uint32_t atMs);
+
+static void applyAck(Zone &z, bool relayOn, uint32_t atMs)
+{
+  z.haveAck = true;
+  z.ackRelayOn = relayOn;
+  z.ackLastMs = atMs;
+  cmdNoteAck(z, relayOn, atMs);
+  chNoteAck(z, atMs);
 }
 
-// receive ACKs from relay
+// First valid ACK for an unpaired zone -> remember the sender; peer add + FS write in relayPairingTick()
+static void learnRelay(uint8_t zi, const uint8_t *mac)
+{
+  if (g_zones[zi].paired || g_zoneLearnPending != 0xFF)
+    return;
+  memcpy(g_zoneLearnMac, mac, 6);
+  g_zoneLearnPending = zi;
+}
+
+// receive ACKs from relay (Wi-Fi task context): copy + timestamp only, no Serial/JSON/heap
 static void onDataRecv(uint8_t *mac, uint8_t *data, uint8_t len)
 {
+  if (len > ESPNOW_RX_MAX)
+  {
+    g_rxOversize++;
+    return;
+  }
+  EspnowRx rx;
+  rx.atMs = millis();
+  memcpy(rx.mac, mac, 6);
+  rx.len = len;
+  memcpy(rx.data, data, len);
+  if (g_rxRing.push(rx))
+    g_rxFrames++;
+}
+
+// Decode + apply one queued frame (loop context)
+static void espnowHandleRx(const EspnowRx &rx)
+{
+  const uint8_t *mac = rx.mac;
+  const uint8_t *data = rx.data;
+  const uint8_t len = rx.len;
+
   Serial.print("[RX] from ");
   printMac(mac);
+
+  if (ef_is_binary(data, len))
+  {
+    EfFrame f;
+    EfResult r = ef_decode(data, len, f);
+    if (r != EF_DECODED)
+    {
+      Serial.printf(" len=%u: bad frame (err=%u)\n", len, (unsigned)r);
+      return;
+    }
+    if (f.type != EF_ACK || !(f.flags & EF_FLAG_OK))
+    {
+      Serial.printf(" len=%u: ignored frame type=%u flags=%02X\n", len, f.type, f.flags);
+      return;
+    }
+    int8_t zi = zoneByRelayId(f.zone);
+    if (zi < 0)
+    {
+      Serial.printf(" ACK for unknown relay id=%u, ignored\n", f.zone);
+      return;
+    }
+    Zone &z = g_zones[zi];
+    if (z.paired && memcmp(mac, z.relayMac, 6) != 0)
+    {
+      Serial.println(" ignored (not the paired relay)");
+      return;
+    }
+    uint32_t rtt = 0;
+    AckMatch m = g_inflight.match(f.seq, rx.atMs, rtt);
+    if (m != ACK_MATCHED)
+    {
+      Serial.printf(" ACK seq=%u %s, dropped\n", f.seq, m == ACK_DUPLICATE ? "duplicate" : "stale");
+      return;
+    }
+    g_rtt.add(rtt);
+    linkSample(z, true);
+    if (!g_txBinary)
+    {
+      g_txBinary = true; // relay speaks binary -> stop sending JSON
+      Serial.print(" [binary relay detected, TX switched to binary]");
+    }
+    applyAck(z, f.value == 1, rx.atMs);
+    learnRelay((uint8_t)zi, mac);
+    Serial.printf(" ACK seq=%u zone=%d rtt=%lums -> relay=%u (%s)\n", f.seq, zi, (unsigned long)rtt, f.value,
+                  z.ackRelayOn ? "ON" : "OFF");
+    return;
+  }
+
   Serial.printf(" len=%u: ", len);
   for (uint8_t i = 0; i < len; i++)
     Serial.write(data[i]);
@@ -161,21 +634,212 @@ static void onDataRecv(uint8_t *mac, uint8_t *data, uint8_t len)
     return;
   }
 
-  // Expected: {"ack":"ON"|"OFF","relay":0|1,"ok":true}
+  // Expected: {"ack":"ON"|"OFF","relay":0|1,"ok":true[,"seq":n][,"id":n]}
   const char *ack = doc["ack"] | nullptr;
   int relay = doc["relay"] | -1;
   bool ok = doc["ok"] | false;
+  long seq = doc["seq"] | -1L;
+  int id = doc["id"] | -1;
   if (!ok || relay < 0)
   {
     Serial.println("[RX] Missing ok/relay in ACK");
     return;
   }
 
-  g_haveAck = true;
-  g_ackRelayOn = (relay == 1) || (ack && strcmp(ack, "ON") == 0);
-  g_ackLastMs = millis();
+  // Route: paired MAC, else echoed id, else the main zone (legacy relay)
+  int8_t zi = zoneByMac(mac);
+  if (zi < 0)
+    zi = (id >= 0) ? zoneByRelayId((uint8_t)id) : 0;
+  if (zi < 0)
+  {
+    Serial.printf("[RX] ACK for unknown relay id=%d, ignored\n", id);
+    return;
+  }
+  Zone &z = g_zones[zi];
+  if (z.paired && memcmp(mac, z.relayMac, 6) != 0)
+  {
+    Serial.println("[RX] ignored (not the paired relay)");
+    return;
+  }
+  if (seq >= 0)
+  {
+    uint32_t rtt = 0;
+    AckMatch m = g_inflight.match((uint16_t)seq, rx.atMs, rtt);
+    if (m != ACK_MATCHED)
+    {
+      Serial.printf("[RX] ACK seq=%ld %s, dropped\n", seq, m == ACK_DUPLICATE ? "duplicate" : "stale");
+      return;
+    }
+    g_rtt.add(rtt);
+  }
+  else
+  {
+    g_ackUncorrelated++; // old relay firmware: no seq echo, accept as before
+  }
+  linkSample(z, true);
+
+  applyAck(z, (relay == 1) || (ack && strcmp(ack, "ON") == 0), rx.atMs);
+  learnRelay((uint8_t)zi, mac);
+
+  Serial.printf("[RX] ACK parsed -> zone=%d relay=%d (%s)\n", zi, relay, z.ackRelayOn ? "ON" : "OFF");
+}
+
+static void espnowDrainRx()
+{
+  EspnowRx rx;
+  while (g_rxRing.pop(rx))
+    espnowHandleRx(rx);
+
+  EspnowTxStatus st;
+  while (g_txStatusRing.pop(st))
+  {
+    if (st.status != 0)
+    {
+      Serial.print("[TX] delivery failed to ");
+      printMac(st.mac);
+      Serial.println();
+    }
+    if (memcmp(st.mac, BROADCAST_MAC, 6) == 0)
+      continue; // broadcast status says nothing about the relay
+    for (uint8_t i = 0; i < MAX_ZONES; ++i)
+      if (g_zones[i].used && g_zones[i].paired && memcmp(g_zones[i].relayMac, st.mac, 6) == 0)
+        linkSample(g_zones[i], st.status == 0);
+  }
+
+  g_inflight.expire(millis(), ACK_TIMEOUT_MS, [](uint8_t zi)
+                    {
+    if (zi < MAX_ZONES)
+      linkSample(g_zones[zi], false); });
+}
+
+// Heater command to a zone's relay: binary frame, or legacy JSON while in compat mode
+static int espnowSendHeater(const Zone &z, bool on)
+{
+  uint8_t buf[48];
+  size_t n;
+  uint16_t seq = ++g_txSeq;
+  if (g_txBinary)
+  {
+    EfFrame f{EF_CMD, z.relayId, seq, (uint8_t)(on ? 1 : 0), 0};
+    n = ef_encode(f, buf, sizeof(buf));
+  }
+  else
+  {
+    JsonDocument jtx;
+    jtx["heater"] = on ? "ON" : "OFF";
+    jtx["id"] = z.relayId;
+    jtx["seq"] = seq;
+    n = serializeJson(jtx, (char *)buf, sizeof(buf));
+  }
+  uint8_t *dest = z.paired ? (uint8_t *)z.relayMac : BROADCAST_MAC;
+  int rc = esp_now_send(dest, buf, (int)n);
+  if (rc == 0)
+    g_inflight.add(seq, millis(), (uint8_t)(&z - g_zones));
+  return rc;
+}
+
+// Channel-scan probe: binary PROBE (no actuation); legacy JSON relays get the current command instead
+static int espnowSendProbe(const Zone &z)
+{
+  if (!g_txBinary)
+    return espnowSendHeater(z, z.heaterOn);
+  uint8_t buf[EF_FRAME_LEN];
+  uint16_t seq = ++g_txSeq;
+  EfFrame f{EF_PROBE, z.relayId, seq, 0, 0};
+  size_t n = ef_encode(f, buf, sizeof(buf));
+  int rc = esp_now_send(z.paired ? (uint8_t *)z.relayMac : BROADCAST_MAC, buf, (int)n);
+  if (rc == 0)
+    g_inflight.add(seq, millis(), (uint8_t)(&z - g_zones));
+  return rc;
+}
+
+// ===== ESP-NOW command scheduler =====
+// Per zone: send at once when the effective heater state changes, otherwise only a heartbeat.
+static const uint32_t CMD_HEARTBEAT_MS = 10000;
+static const uint32_t ACK_STALE_MS = 3 * CMD_HEARTBEAT_MS; // UI "Caldaia: stale" after this
+static const uint32_t CMD_PROBE_MS = 2000; // heartbeat cadence while a zone's link is down
+
+static uint32_t g_cmdChanges = 0;
+
+// Frames-per-hour (fixed 1 h windows) + command-to-ACK latency, all zones together
+static uint32_t g_txFrames = 0;
+static uint32_t g_txFramesThisHour = 0;
+static uint32_t g_txFramesLastHour = 0;
+static uint32_t g_txHourStartMs = 0;
+static uint32_t g_ackLatLastMs = 0;
+static uint32_t g_ackLatMaxMs = 0;
+static uint32_t g_ackLatSumMs = 0;
+static uint32_t g_ackLatCount = 0;
+
+static void cmdNoteAck(Zone &z, bool relayOn, uint32_t atMs)
+{
+  if (relayOn == z.heaterOn)
+    z.arq.stop(); // relay confirmed the commanded state
+  if (!z.cmdAwaitAck || relayOn != z.heaterOn)
+    return;
+  z.cmdAwaitAck = false;
+  uint32_t lat = atMs - z.cmdChangeAtMs;
+  g_ackLatLastMs = lat;
+  if (lat > g_ackLatMaxMs)
+    g_ackLatMaxMs = lat;
+  g_ackLatSumMs += lat;
+  g_ackLatCount++;
+}
+
+static void cmdCountFrame(uint32_t now)
+{
+  if (now - g_txHourStartMs >= 3600000UL)
+  {
+    g_txFramesLastHour = g_txFramesThisHour;
+    g_txFramesThisHour = 0;
+    g_txHourStartMs = now;
+  }
+  g_txFrames++;
+  g_txFramesThisHour++;
+}
+
+// `changed` = effective heater state differs from the last one sent
+static void cmdSchedulerTick(Zone &z, bool changed)
+{
+  uint32_t now = millis();
+  changed = changed || !z.cmdSentOnce;
+
+  // ARQ: unacknowledged state change -> retry with backoff (not while the link is down)
+  if (!changed && z.arq.due(now))
+  {
+    if (z.arq.onTimeout(now, ARQ_DEFAULTS))
+    {
+      cmdCountFrame(now);
+      z.cmdLastTxMs = now;
+      int rc = espnowSendHeater(z, z.heaterOn);
+      Serial.printf("[TX] id=%u retry #%u %s -> %s\n", z.relayId, z.arq.attempts(), z.heaterOn ? "ON" : "OFF",
+                    rc == 0 ? "OK" : String(rc).c_str());
+    }
+    else
+    {
+      Serial.printf("[TX] id=%u no ACK after %u retries, waiting for heartbeat\n", z.relayId, z.arq.attempts());
+    }
+    return;
+  }
+
+  if (!changed && now - z.cmdLastTxMs < (z.link.down() ? CMD_PROBE_MS : CMD_HEARTBEAT_MS))
+    return;
+
+  if (changed)
+  {
+    g_cmdChanges++;
+    z.cmdAwaitAck = true;
+    z.cmdChangeAtMs = now;
+    if (!z.link.down())
+      z.arq.start(now, ARQ_DEFAULTS);
+  }
+  z.cmdSentOnce = true;
+  z.cmdLastTxMs = now;
+  cmdCountFrame(now);
 
-  Serial.printf("[RX] ACK parsed -> relay=%d (%s)\n", relay, g_ackRelayOn ? "ON" : "OFF");
+  int rc = espnowSendHeater(z, z.heaterOn);
+  Serial.printf("[TX] id=%u %s %s -> %s\n", z.relayId, changed ? "change" : "heartbeat", z.heaterOn ? "ON" : "OFF",
+                rc == 0 ? "OK" : String(rc).c_str());
 }
 
 // ======== Thermostat HTML (UI) ========
@@ -317,6 +981,10 @@ body{
         <div class="hint" id="state">—</div>
       </div>
     </div>
+
+    <div class="card">
+      <div class="hint" id="learn">Heat rate: learning…</div>
+    </div>
   </div>
 </div>
 
@@ -400,7 +1068,7 @@ async function tick(){
     let ackFresh = false;
     if (hasAck) {
       const age = (typeof j.ackAgeMs === 'number') ? j.ackAgeMs : 0;
-      ackFresh = age <= 5000;
+      ackFresh = age <= ((typeof j.ackStaleMs === 'number') ? j.ackStaleMs : 5000);
     }
     document.getElementById('calDot').className = 'dot ' + (ackFresh ? 'on' : 'off');
     document.getElementById('calText').textContent = ackFresh ? 'Caldaia: OK' : (hasAck ? 'Caldaia: stale' : 'Caldaia: —');
@@ -420,6 +1088,19 @@ async function tick(){
       wifiLabel = 'Wi-Fi: offline';
     }
     document.getElementById('wifiText').textContent = wifiLabel;
+
+    // Learned rates + optimal start (zone 0)
+    const z0 = (j.zones || [])[0] || {};
+    const lr = z0.learn || {};
+    const rate = v => (typeof v === 'number') ? ((v>=0?'+':'') + v.toFixed(3) + ' °C/min') : 'learning…';
+    let txt = 'Heat rate: ' + rate(lr.heatPerMin) + ' · Cool rate: ' + rate(lr.coolPerMin);
+    const ph = j.preheat || {};
+    if (typeof ph.next === 'number' && typeof ph.inS === 'number' && ph.inS > 0){
+      txt += ' · Next: ' + fmt(ph.next) + ' in ' + Math.round(ph.inS/60) + ' min';
+      if (ph.active) txt += ' (preheating)';
+      else if (ph.leadS > 0) txt += ' (preheat ' + Math.round(ph.leadS/60) + ' min ahead)';
+    }
+    document.getElementById('learn').textContent = txt;
   }catch(e){}
 }
 
@@ -599,10 +1280,13 @@ loadScan(); loadCurrent();
 // ====== Persistence for fixed setpoint ======
 static const char *FIXED_PATH = "/fixed_setpoint.json";
 static const char *WIFI_PATH = "/wifi.json";
+static const char *RELAY_PATH = "/relay.json"; // pre-zones single relay, migrated on boot
+static const char *ZONES_PATH = "/zones.bin";
+static const char *SENSORS_PATH = "/sensors.json";
 
 static void loadFixedSetpoint()
 {
-  g_fixedSetpoint = 19.0f;
+  g_fixedSetpoint = 1900;
   g_fixedPreset = "on";
   g_fixedEnabled = true;
   if (!LittleFS.exists(FIXED_PATH))
@@ -613,22 +1297,22 @@ static void loadFixedSetpoint()
   JsonDocument doc;
   if (deserializeJson(doc, f) == DeserializationError::Ok)
   {
-    float sp = doc["setpoint"] | g_fixedSetpoint;
+    cdeg_t sp = cdeg_from_c(doc["setpoint"] | NAN); // file keeps °C as a JSON number
     const char *pr = doc["preset"] | g_fixedPreset.c_str();
     bool en = doc["enabled"] | true;
-    if (sp >= 5 && sp <= 35)
+    if (cdeg_valid(sp) && sp >= 500 && sp <= 3500)
       g_fixedSetpoint = sp;
     g_fixedPreset = pr;
     g_fixedEnabled = en;
   }
   f.close();
-  Serial.printf("[FS] Fixed setpoint loaded: %.1f (%s)\n", g_fixedSetpoint, g_fixedPreset.c_str());
+  Serial.printf("[FS] Fixed setpoint loaded: %.1f (%s)\n", cdeg_to_c(g_fixedSetpoint), g_fixedPreset.c_str());
 }
 
 static bool saveFixedSetpoint()
 {
   JsonDocument doc;
-  doc["setpoint"] = g_fixedSetpoint;
+  doc["setpoint"] = cdeg_to_c(g_fixedSetpoint);
   doc["preset"] = g_fixedPreset;
   doc["enabled"] = g_fixedEnabled;
   File f = LittleFS.open(FIXED_PATH, "w");
@@ -645,7 +1329,7 @@ static bool saveFixedSetpoint()
 
 static bool saveFixedSetpointIfNeeded(bool force = false)
 {
-  if (!isnan(g_lastSavedSetpoint) && fabsf(g_fixedSetpoint - g_lastSavedSetpoint) < SP_EPS)
+  if (cdeg_valid(g_lastSavedSetpoint) && abs(g_fixedSetpoint - g_lastSavedSetpoint) < SP_EPS_CD)
     return true;
   if (!force && (millis() - g_lastFsWriteMs < FS_WRITE_MIN_GAP_MS))
     return true;
@@ -658,106 +1342,654 @@ static bool saveFixedSetpointIfNeeded(bool force = false)
   return ok;
 }
 
-// Wi-Fi credentials persistence
-static void loadWifiCreds()
+// Zone table persistence: 4-byte header + fixed 20-byte records (~210 B, no JSON)
+//   header: 'Z' 'N' version count
+//   record: flags(bit0 used, bit1 paired) relayId setpoint(int16 LE, 0.01 °C) mac[6] rom[8]
+//           agg sensorMask          (v2; v1 files have 18-byte records without them)
+static const uint8_t ZONES_FILE_VER = 2;
+static const size_t ZONE_REC_LEN = 20;
+static const size_t ZONE_REC_LEN_V1 = 18;
+
+static void zoneDefaults()
 {
-  g_wifiSsid = WIFI_SSID_DEFAULT;
-  g_wifiPass = WIFI_PASS_DEFAULT;
-  if (!LittleFS.exists(WIFI_PATH))
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
   {
-    Serial.printf("[FS] No /wifi.json, using defaults SSID=%s\n", WIFI_SSID_DEFAULT);
-    return;
+    g_zones[i] = Zone();
+    g_zones[i].arq.seed(ESP.random() ^ i);
+    g_zones[i].relayId = (uint8_t)(LEGACY_RELAY_ID + i);
+    g_zones[i].setpoint = 1900;
+    g_zones[i].temp = CDEG_INVALID;
   }
-  File f = LittleFS.open(WIFI_PATH, "r");
+  g_zones[0].used = true;
+}
+
+static bool saveZones()
+{
+  File f = LittleFS.open(ZONES_PATH, "w");
   if (!f)
   {
-    Serial.println("[FS] open /wifi.json failed");
-    return;
+    Serial.println("[FS] open write failed (/zones.bin)");
+    return false;
   }
+  uint8_t hdr[4] = {'Z', 'N', ZONES_FILE_VER, MAX_ZONES};
+  bool ok = f.write(hdr, sizeof(hdr)) == sizeof(hdr);
+  for (uint8_t i = 0; ok && i < MAX_ZONES; ++i)
+  {
+    const Zone &z = g_zones[i];
+    uint8_t r[ZONE_REC_LEN];
+    int16_t sp = z.setpoint; // already 0.01 °C
+    r[0] = (z.used ? 0x01 : 0) | (z.paired ? 0x02 : 0);
+    r[1] = z.relayId;
+    r[2] = (uint8_t)(sp & 0xFF);
+    r[3] = (uint8_t)((uint16_t)sp >> 8);
+    memcpy(r + 4, z.relayMac, 6);
+    memcpy(r + 10, z.sensorRom, 8);
+    r[18] = z.sensorAgg;
+    r[19] = z.sensorMask;
+    ok = f.write(r, sizeof(r)) == sizeof(r);
+  }
+  f.close();
+  Serial.println(ok ? "[FS] Zones saved" : "[FS] Zones save failed");
+  return ok;
+}
+
+// One-time import of the single paired relay from /relay.json into zone 0
+static void migrateRelayJson()
+{
+  if (!LittleFS.exists(RELAY_PATH))
+    return;
+  File f = LittleFS.open(RELAY_PATH, "r");
+  if (!f)
+    return;
   JsonDocument doc;
   if (deserializeJson(doc, f) == DeserializationError::Ok)
+    g_zones[0].paired = parseMac(doc["mac"] | "", g_zones[0].relayMac);
+  f.close();
+  if (saveZones())
+    LittleFS.remove(RELAY_PATH);
+  Serial.println("[FS] /relay.json migrated to zone 0");
+}
+
+static void loadZones()
+{
+  zoneDefaults();
+  if (!LittleFS.exists(ZONES_PATH))
   {
-    const char *s = doc["ssid"] | WIFI_SSID_DEFAULT;
-    const char *p = doc["pass"] | WIFI_PASS_DEFAULT;
-    g_wifiSsid = s;
-    g_wifiPass = p;
-    Serial.printf("[FS] Wi-Fi loaded: SSID=%s\n", g_wifiSsid.c_str());
+    migrateRelayJson();
+    Serial.println("[FS] No /zones.bin, single main zone");
+    return;
   }
-  else
+  File f = LittleFS.open(ZONES_PATH, "r");
+  if (!f)
+    return;
+  uint8_t hdr[4];
+  if (f.read(hdr, sizeof(hdr)) != sizeof(hdr) || hdr[0] != 'Z' || hdr[1] != 'N' || hdr[2] < 1 ||
+      hdr[2] > ZONES_FILE_VER)
   {
-    Serial.println("[FS] /wifi.json parse error; using defaults");
+    f.close();
+    Serial.println("[FS] /zones.bin bad header; using defaults");
+    return;
+  }
+  uint8_t count = hdr[3] < MAX_ZONES ? hdr[3] : MAX_ZONES;
+  const size_t recLen = hdr[2] == 1 ? ZONE_REC_LEN_V1 : ZONE_REC_LEN;
+  for (uint8_t i = 0; i < count; ++i)
+  {
+    uint8_t r[ZONE_REC_LEN] = {0}; // v1: agg/mask stay 0 (control sensor)
+    if (f.read(r, recLen) != recLen)
+      break;
+    Zone &z = g_zones[i];
+    z.used = r[0] & 0x01;
+    z.paired = r[0] & 0x02;
+    z.relayId = r[1];
+    cdeg_t sp = (cdeg_t)(r[2] | ((uint16_t)r[3] << 8));
+    if (sp >= 500 && sp <= 3500)
+      z.setpoint = sp;
+    memcpy(z.relayMac, r + 4, 6);
+    memcpy(z.sensorRom, r + 10, 8);
+    z.sensorAgg = r[18] <= ZA_MEAN ? r[18] : (uint8_t)ZA_CONTROL;
+    z.sensorMask = r[19];
   }
   f.close();
+  g_zones[0].used = true; // main zone always active
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    n += g_zones[i].used ? 1 : 0;
+  Serial.printf("[FS] Zones loaded: %u active\n", n);
 }
-static bool saveWifiCreds(const String &ssid, const String &pass)
+
+// Sensor labels: {"sensors":[{"rom":"28:..","label":"..."}]} in table order
+static bool saveSensors()
 {
   JsonDocument doc;
-  doc["ssid"] = ssid;
-  doc["pass"] = pass;
-  File f = LittleFS.open(WIFI_PATH, "w");
+  JsonArray arr = doc["sensors"].to<JsonArray>();
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+  {
+    char rom[24];
+    formatRom(g_sensors[i].rom, rom);
+    JsonObject o = arr.add<JsonObject>();
+    o["rom"] = rom;
+    o["label"] = g_sensors[i].label;
+  }
+  File f = LittleFS.open(SENSORS_PATH, "w");
   if (!f)
   {
-    Serial.println("[FS] open write failed (/wifi.json)");
+    Serial.println("[FS] open write failed (/sensors.json)");
     return false;
   }
   bool ok = (serializeJson(doc, f) > 0);
   f.close();
-  Serial.println(ok ? "[FS] Wi-Fi creds saved" : "[FS] Wi-Fi creds save failed");
+  Serial.println(ok ? "[FS] Sensors saved" : "[FS] Sensors save failed");
   return ok;
 }
 
-// ====== (Legacy) 7×24 schedule kept but unused ======
-float setpoints[7][24];
-static void initLegacySchedule()
-{
-  for (int d = 0; d < 7; ++d)
-    for (int h = 0; h < 24; ++h)
-      setpoints[d][h] = g_fixedSetpoint;
-}
-
-// ===== HTTPS GET to cesana.steplab.net =====
-static bool cesanaReportAndFetch(float tempC, bool heatingFromAck /* true=ON, false=OFF */)
+static void loadSensors()
 {
-  // Only report in STA mode, not in AP
-  if (WiFi.status() != WL_CONNECTED || g_apActive)
+  g_sensorCount = 0;
+  if (!LittleFS.exists(SENSORS_PATH))
+    return;
+  File f = LittleFS.open(SENSORS_PATH, "r");
+  if (!f)
+    return;
+  JsonDocument doc;
+  if (deserializeJson(doc, f) == DeserializationError::Ok)
   {
-    return false;
+    for (JsonObject o : doc["sensors"].as<JsonArray>())
+    {
+      if (g_sensorCount >= MAX_SENSORS)
+        break;
+      DsSensor &s = g_sensors[g_sensorCount];
+      s = DsSensor();
+      if (!parseHexBytes(o["rom"] | "", s.rom, 8))
+        continue;
+      strlcpy(s.label, o["label"] | "", sizeof(s.label));
+      s.temp = s.rawTemp = CDEG_INVALID;
+      g_sensorCount++;
+    }
   }
+  f.close();
+  Serial.printf("[FS] Sensors loaded: %u known\n", g_sensorCount);
+}
 
-  String url = "https://cesana.steplab.net/get_setpoint.php?temp=";
-  url += String(tempC, 1);
-  url += "&cald=";
-  url += (heatingFromAck ? "1" : "0");
-
-  std::unique_ptr<BearSSL::WiFiClientSecure> client(new BearSSL::WiFiClientSecure);
-  client->setInsecure();
-  client->setTimeout(600); // tight socket timeout (ms)
+// Controller: {"mode":"hysteresis"|"tpi","cycleS":600,"kp":50,"tiS":1800,"minPulseS":60,
+//              "minOnS":180,"minOffS":180,"maxOnS":3600,"cooldownS":1800,
+//              "reportDelta":0.2,"heartbeatS":300,"pullS":30}
+// kp in % duty per °C of error; minOnS..cooldownS drive the heater output state machine;
+// the last three pace the cesana poll (report_policy.h)
+static const char *CONTROL_PATH = "/control.json";
 
-  HTTPClient https;
-  https.setTimeout(800); // total request timeout (ms)
-  https.setReuse(false);
+// Fields of controlFromJson() that failed its checks
+enum CtlField : uint16_t
+{
+  CF_MODE = 1u << 0,
+  CF_CYCLE = 1u << 1,
+  CF_KP = 1u << 2,
+  CF_TI = 1u << 3,
+  CF_MINPULSE = 1u << 4, // also: more than half the cycle
+  CF_MINON = 1u << 5,
+  CF_MINOFF = 1u << 6,
+  CF_MAXON = 1u << 7, // also: below minOnS
+  CF_COOLDOWN = 1u << 8,
+  CF_DELTA = 1u << 9,
+  CF_HEARTBEAT = 1u << 10,
+  CF_PULL = 1u << 11,
+  CF_PULSE = 1u << 12, // TPI with minOnS/minOffS windows that leave no room in the cycle
+};
 
-  Serial.printf("[HTTP] GET %s\n", url.c_str());
-  if (!https.begin(*client, url))
-  {
-    Serial.println("[HTTP] begin() failed");
+// One "...S" field: absent -> unchanged; whole seconds in lo..hi -> ms; anything else -> false
+static bool jsonSecsToMs(JsonVariantConst v, uint32_t lo, uint32_t hi, uint32_t &ms)
+{
+  if (v.isNull())
+    return true;
+  if (!v.is<uint32_t>())
     return false;
-  }
-  int code = https.GET();
+  const uint32_t sec = v.as<uint32_t>();
+  if (sec < lo || sec > hi)
+    return false;
+  ms = sec * 1000UL;
+  return true;
+}
+
+// Limits between fields, on the values that would run
+static uint16_t controlCrossCheck(uint8_t mode, const TpiConfig &t, const HeaterConfig &h)
+{
+  uint16_t bad = 0;
+  if (t.minPulseMs * 2 > t.cycleMs)
+    bad |= CF_MINPULSE;
+  if (h.maxOnMs && h.maxOnMs < h.minOnMs)
+    bad |= CF_MAXON;
+  // TPI windows are no shorter than minOnS/minOffS (tpi_effective): both an ON and an OFF
+  // window must still fit in one cycle, or the duty could only be 0 or 100 %
+  const TpiConfig run = tpi_effective(t, h.minOnMs, h.minOffMs);
+  if (mode == CTL_TPI && run.minPulseMs * 2 > run.cycleMs)
+    bad |= CF_PULSE;
+  return bad;
+}
+
+// Range checks for POST /api/control and /control.json alike: every field present and in range is
+// applied onto mode/t/h/r, one out of range is left as it was. Returns the CF_* bits that failed.
+static uint16_t controlFromJson(JsonVariantConst in, uint8_t &mode, TpiConfig &t, HeaterConfig &h, ReportConfig &r)
+{
+  uint16_t bad = 0;
+  if (!in["mode"].isNull())
+  {
+    const char *m = in["mode"] | "";
+    if (strcmp(m, "hysteresis") == 0)
+      mode = CTL_HYSTERESIS;
+    else if (strcmp(m, "tpi") == 0)
+      mode = CTL_TPI;
+    else
+      bad |= CF_MODE;
+  }
+  if (!jsonSecsToMs(in["cycleS"], 60, 3600, t.cycleMs))
+    bad |= CF_CYCLE;
+  if (!in["kp"].isNull())
+  {
+    const uint32_t kp = in["kp"].is<uint32_t>() ? in["kp"].as<uint32_t>() : 0; // % duty per °C
+    if (kp >= 1 && kp <= 1000)
+      t.kpPmPerC = (uint16_t)(kp * 10);
+    else
+      bad |= CF_KP;
+  }
+  if (!jsonSecsToMs(in["tiS"], 0, 86400, t.tiMs))
+    bad |= CF_TI;
+  if (!jsonSecsToMs(in["minPulseS"], 0, 1800, t.minPulseMs))
+    bad |= CF_MINPULSE;
+  if (!jsonSecsToMs(in["minOnS"], 0, 1800, h.minOnMs))
+    bad |= CF_MINON;
+  if (!jsonSecsToMs(in["minOffS"], 0, 1800, h.minOffMs))
+    bad |= CF_MINOFF;
+  if (!jsonSecsToMs(in["maxOnS"], 0, 86400, h.maxOnMs))
+    bad |= CF_MAXON;
+  if (!jsonSecsToMs(in["cooldownS"], 0, 7200, h.cooldownMs))
+    bad |= CF_COOLDOWN;
+  if (!in["reportDelta"].isNull())
+  {
+    const cdeg_t delta = cdeg_from_c(in["reportDelta"] | NAN);
+    if (cdeg_valid(delta) && delta >= 5 && delta <= 500)
+      r.deltaCd = delta;
+    else
+      bad |= CF_DELTA;
+  }
+  if (!jsonSecsToMs(in["heartbeatS"], 10, 3600, r.heartbeatMs))
+    bad |= CF_HEARTBEAT;
+  if (!jsonSecsToMs(in["pullS"], 2, 3600, r.pullMs))
+    bad |= CF_PULL;
+  return bad | controlCrossCheck(mode, t, h);
+}
+
+static void loadControl()
+{
+  g_ctlMode = CTL_HYSTERESIS;
+  g_tpiCfg = TPI_DEFAULTS;
+  g_heaterCfg = HEATER_DEFAULTS;
+  g_reportCfg = REPORT_DEFAULTS;
+  if (!LittleFS.exists(CONTROL_PATH))
+    return;
+  File f = LittleFS.open(CONTROL_PATH, "r");
+  if (!f)
+    return;
+  JsonDocument doc;
+  if (deserializeJson(doc, f) == DeserializationError::Ok)
+  {
+    // A field out of range keeps its default; so do both sides of a failed limit between fields
+    const uint16_t bad = controlFromJson(doc.as<JsonVariantConst>(), g_ctlMode, g_tpiCfg, g_heaterCfg, g_reportCfg);
+    if (bad & CF_MINPULSE)
+    {
+      g_tpiCfg.cycleMs = TPI_DEFAULTS.cycleMs;
+      g_tpiCfg.minPulseMs = TPI_DEFAULTS.minPulseMs;
+    }
+    if (bad & CF_MAXON)
+    {
+      g_heaterCfg.minOnMs = HEATER_DEFAULTS.minOnMs;
+      g_heaterCfg.maxOnMs = HEATER_DEFAULTS.maxOnMs;
+    }
+    if (controlCrossCheck(g_ctlMode, g_tpiCfg, g_heaterCfg) & CF_PULSE)
+      g_ctlMode = CTL_HYSTERESIS; // min ON/OFF leave TPI no duty range
+    if (bad)
+      Serial.printf("[FS] /control.json out of range (fields 0x%04x), defaults used for those\n", bad);
+  }
+  f.close();
+  Serial.printf("[FS] Controller: %s\n", ctlModeName(g_ctlMode));
+}
+
+static bool saveControl()
+{
+  JsonDocument doc;
+  doc["mode"] = ctlModeName(g_ctlMode);
+  doc["cycleS"] = g_tpiCfg.cycleMs / 1000;
+  doc["kp"] = g_tpiCfg.kpPmPerC / 10;
+  doc["tiS"] = g_tpiCfg.tiMs / 1000;
+  doc["minPulseS"] = g_tpiCfg.minPulseMs / 1000;
+  doc["minOnS"] = g_heaterCfg.minOnMs / 1000;
+  doc["minOffS"] = g_heaterCfg.minOffMs / 1000;
+  doc["maxOnS"] = g_heaterCfg.maxOnMs / 1000;
+  doc["cooldownS"] = g_heaterCfg.cooldownMs / 1000;
+  doc["reportDelta"] = cdeg_to_c(g_reportCfg.deltaCd);
+  doc["heartbeatS"] = g_reportCfg.heartbeatMs / 1000;
+  doc["pullS"] = g_reportCfg.pullMs / 1000;
+  File f = LittleFS.open(CONTROL_PATH, "w");
+  if (!f)
+  {
+    Serial.println("[FS] open write failed (/control.json)");
+    return false;
+  }
+  bool ok = (serializeJson(doc, f) > 0);
+  f.close();
+  Serial.println(ok ? "[FS] Controller saved" : "[FS] Controller save failed");
+  return ok;
+}
+
+// Local schedule: 11-byte header + 4-byte records (little-endian)
+//   header: 'W' 'S' version count flags(bit0 follow AUTO) scheduleVersion(uint32) manual(int16)
+//   record: minuteOfWeek(uint16) setpoint(int16, 0.01 °C)
+static const char *SCHEDULE_PATH = "/schedule.bin";
+static const uint8_t SCHEDULE_FILE_VER = 1;
+static const size_t SCHEDULE_HDR_LEN = 11;
+
+static void putLe(uint8_t *p, uint32_t v, uint8_t n)
+{
+  for (uint8_t i = 0; i < n; ++i)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t getLe(const uint8_t *p, uint8_t n)
+{
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < n; ++i)
+    v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
+
+static bool saveSchedule()
+{
+  File f = LittleFS.open(SCHEDULE_PATH, "w");
+  if (!f)
+  {
+    Serial.println("[FS] open write failed (/schedule.bin)");
+    return false;
+  }
+  uint8_t hdr[SCHEDULE_HDR_LEN] = {'W', 'S', SCHEDULE_FILE_VER, g_sched.count(), (uint8_t)(g_schedFollow ? 1 : 0)};
+  putLe(hdr + 5, g_sched.version(), 4);
+  putLe(hdr + 9, (uint16_t)g_sched.manual(), 2);
+  bool ok = f.write(hdr, sizeof(hdr)) == sizeof(hdr);
+  for (uint8_t i = 0; ok && i < g_sched.count(); ++i)
+  {
+    uint8_t r[4];
+    putLe(r, g_sched.slot(i).minute, 2);
+    putLe(r + 2, (uint16_t)g_sched.slot(i).sp, 2);
+    ok = f.write(r, sizeof(r)) == sizeof(r);
+  }
+  f.close();
+  Serial.println(ok ? "[FS] Schedule saved" : "[FS] Schedule save failed");
+  return ok;
+}
+
+static void loadSchedule()
+{
+  g_schedLoaded = false;
+  if (!LittleFS.exists(SCHEDULE_PATH))
+    return;
+  File f = LittleFS.open(SCHEDULE_PATH, "r");
+  if (!f)
+    return;
+  uint8_t hdr[SCHEDULE_HDR_LEN];
+  if (f.read(hdr, sizeof(hdr)) != sizeof(hdr) || hdr[0] != 'W' || hdr[1] != 'S' || hdr[2] != SCHEDULE_FILE_VER)
+  {
+    f.close();
+    Serial.println("[FS] /schedule.bin bad header; waiting for a sync");
+    return;
+  }
+  g_schedFollow = hdr[4] & 0x01;
+  g_sched.clear(getLe(hdr + 5, 4), (cdeg_t)getLe(hdr + 9, 2));
+  bool ok = true;
+  for (uint8_t i = 0; ok && i < hdr[3]; ++i)
+  {
+    uint8_t r[4];
+    ok = f.read(r, sizeof(r)) == sizeof(r);
+    if (ok)
+    {
+      const uint16_t mw = (uint16_t)getLe(r, 2);
+      ok = g_sched.add((uint8_t)(mw / WeekSchedule::MIN_PER_DAY), mw % WeekSchedule::MIN_PER_DAY,
+                       (cdeg_t)getLe(r + 2, 2));
+    }
+  }
+  f.close();
+  g_schedLoaded = ok;
+  Serial.printf("[FS] Schedule %08lx: %u slots, %s\n", (unsigned long)g_sched.version(), g_sched.count(),
+                ok ? (g_schedFollow ? "following (AUTO)" : "idle") : "corrupt, waiting for a sync");
+}
+
+// Learned rates: 4-byte header + one 12-byte record per zone (little-endian)
+//   header: 'H' 'R' version count
+//   record: heatX16(int32) coolX16(int32) heatSegs(uint16) coolSegs(uint16)
+static const char *HEATRATE_PATH = "/heatrate.bin";
+static const uint8_t HEATRATE_FILE_VER = 1;
+static const size_t HEATRATE_REC_LEN = 12;
+
+static bool saveHeatRates()
+{
+  File f = LittleFS.open(HEATRATE_PATH, "w");
+  if (!f)
+  {
+    Serial.println("[FS] open write failed (/heatrate.bin)");
+    return false;
+  }
+  uint8_t hdr[4] = {'H', 'R', HEATRATE_FILE_VER, MAX_ZONES};
+  bool ok = f.write(hdr, sizeof(hdr)) == sizeof(hdr);
+  for (uint8_t i = 0; ok && i < MAX_ZONES; ++i)
+  {
+    const HeatRateState &st = g_zones[i].learn.state();
+    uint8_t r[HEATRATE_REC_LEN];
+    putLe(r, (uint32_t)st.heatX16, 4);
+    putLe(r + 4, (uint32_t)st.coolX16, 4);
+    putLe(r + 8, st.heatSegs, 2);
+    putLe(r + 10, st.coolSegs, 2);
+    ok = f.write(r, sizeof(r)) == sizeof(r);
+  }
+  f.close();
+  Serial.println(ok ? "[FS] Heat rates saved" : "[FS] Heat rates save failed");
+  return ok;
+}
+
+static void loadHeatRates()
+{
+  if (!LittleFS.exists(HEATRATE_PATH))
+    return;
+  File f = LittleFS.open(HEATRATE_PATH, "r");
+  if (!f)
+    return;
+  uint8_t hdr[4];
+  if (f.read(hdr, sizeof(hdr)) != sizeof(hdr) || hdr[0] != 'H' || hdr[1] != 'R' || hdr[2] != HEATRATE_FILE_VER)
+  {
+    f.close();
+    Serial.println("[FS] /heatrate.bin bad header; learning from scratch");
+    return;
+  }
+  uint8_t count = hdr[3] < MAX_ZONES ? hdr[3] : MAX_ZONES;
+  for (uint8_t i = 0; i < count; ++i)
+  {
+    uint8_t r[HEATRATE_REC_LEN];
+    if (f.read(r, sizeof(r)) != sizeof(r))
+      break;
+    HeatRateState st;
+    st.heatX16 = (int32_t)getLe(r, 4);
+    st.coolX16 = (int32_t)getLe(r + 4, 4);
+    st.heatSegs = (uint16_t)getLe(r + 8, 2);
+    st.coolSegs = (uint16_t)getLe(r + 10, 2);
+    g_zones[i].learn.restore(st);
+  }
+  f.close();
+  const HeatRateLearner &l = g_zones[0].learn;
+  Serial.printf("[FS] Heat rates loaded: zone 0 heat %+.2f cool %+.2f C/h\n", l.heatCdPerH() / 100.0f,
+                l.coolCdPerH() / 100.0f);
+}
+
+// Wi-Fi credentials persistence
+static void loadWifiCreds()
+{
+  g_wifiSsid = WIFI_SSID_DEFAULT;
+  g_wifiPass = WIFI_PASS_DEFAULT;
+  if (!LittleFS.exists(WIFI_PATH))
+  {
+    Serial.printf("[FS] No /wifi.json, using defaults SSID=%s\n", WIFI_SSID_DEFAULT);
+    return;
+  }
+  File f = LittleFS.open(WIFI_PATH, "r");
+  if (!f)
+  {
+    Serial.println("[FS] open /wifi.json failed");
+    return;
+  }
+  JsonDocument doc;
+  if (deserializeJson(doc, f) == DeserializationError::Ok)
+  {
+    const char *s = doc["ssid"] | WIFI_SSID_DEFAULT;
+    const char *p = doc["pass"] | WIFI_PASS_DEFAULT;
+    g_wifiSsid = s;
+    g_wifiPass = p;
+    Serial.printf("[FS] Wi-Fi loaded: SSID=%s\n", g_wifiSsid.c_str());
+  }
+  else
+  {
+    Serial.println("[FS] /wifi.json parse error; using defaults");
+  }
+  f.close();
+}
+static bool saveWifiCreds(const String &ssid, const String &pass)
+{
+  JsonDocument doc;
+  doc["ssid"] = ssid;
+  doc["pass"] = pass;
+  File f = LittleFS.open(WIFI_PATH, "w");
+  if (!f)
+  {
+    Serial.println("[FS] open write failed (/wifi.json)");
+    return false;
+  }
+  bool ok = (serializeJson(doc, f) > 0);
+  f.close();
+  Serial.println(ok ? "[FS] Wi-Fi creds saved" : "[FS] Wi-Fi creds save failed");
+  return ok;
+}
+
+// ===== Local weekly schedule: is the local copy in charge? =====
+// In charge while the server mode is AUTO and the local copy is current (or the server is
+// unreachable since boot), and the clock is set
+static bool schedLocalActive()
+{
+  if (!g_schedLoaded || !g_schedFollow || time(nullptr) < 1700000000)
+    return false;
+  return !g_schedRemoteVerKnown || g_sched.version() == g_schedRemoteVer;
+}
+
+// ===== HTTPS GET to CESANA_HOST =====
+// One long-lived TLS client: HTTP keep-alive reuses the socket between polls; when the server
+// closed it, the cached BearSSL session lets the reconnect resume instead of a full handshake.
+// Whether keep-alive spans the 30 s pull depends on the server's idle timeout (Apache and
+// LiteSpeed 5 s: never; nginx 75 s: almost always); resumption only needs the server's session
+// cache (5 min by default in Apache and nginx) to outlive the gap between requests.
+static BearSSL::WiFiClientSecure g_tls;
+static BearSSL::Session g_tlsSession;
+static HTTPClient g_https;
+static bool g_tlsInit = false;
+static TlsLinkStats g_tlsStats;
+static MsStat g_tlsLatReused; // request latency on a kept-alive socket
+static MsStat g_tlsLatNew;    // request latency including connect + handshake
+
+// BearSSL::Session is a bare br_ssl_session_parameters, filled by the core with
+// br_ssl_engine_get_session_parameters() after each handshake; the engine itself is private
+static_assert(sizeof(BearSSL::Session) == sizeof(br_ssl_session_parameters), "BearSSL::Session layout");
+
+static TlsSessionId tlsSessionId(const BearSSL::Session &s)
+{
+  br_ssl_session_parameters p;
+  memcpy(&p, &s, sizeof(p));
+  TlsSessionId id = {};
+  id.len = p.session_id_len <= sizeof(id.id) ? p.session_id_len : 0;
+  memcpy(id.id, p.session_id, id.len);
+  return id;
+}
+
+// One GET of CESANA_PATH + query; the body of a 200 reply in payload
+static bool cesanaGet(const String &query, String &payload)
+{
+  if (!g_tlsInit)
+  {
+    g_tlsInit = true;
+    g_tls.setInsecure();
+    g_tls.setSession(&g_tlsSession);
+    g_tls.setTimeout(600);   // tight socket timeout (ms)
+    g_https.setTimeout(800); // total request timeout (ms)
+    g_https.setReuse(true);  // keep-alive
+  }
+
+  const String uri = String(CESANA_PATH) + query;
+  Serial.printf("[HTTP] GET https://%s:%u%s\n", CESANA_HOST, (unsigned)CESANA_PORT, uri.c_str());
+  const bool reused = g_tls.connected();
+  const TlsSessionId before = tlsSessionId(g_tlsSession);
+  const uint32_t t0 = millis();
+  if (!g_https.begin(g_tls, CESANA_HOST, CESANA_PORT, uri, true))
+  {
+    Serial.println("[HTTP] begin() failed");
+    g_tlsStats.record(reused, false, before, before, false);
+    return false;
+  }
+  int code = g_https.GET();
+  const TlsSessionId after = tlsSessionId(g_tlsSession);
   if (code <= 0)
   {
-    Serial.printf("[HTTP] GET failed: %s\n", https.errorToString(code).c_str());
-    https.end();
+    Serial.printf("[HTTP] GET failed: %s\n", g_https.errorToString(code).c_str());
+    g_https.end();
+    g_tls.stop(); // next request starts from a clean connection (session kept)
+    g_tlsStats.record(reused, false, before, after, false);
     return false;
   }
-  Serial.printf("[HTTP] Status: %d\n", code);
+  Serial.printf("[HTTP] Status: %d (%s)\n", code,
+                reused ? "kept-alive" : (tls_same_session(before, after) ? "resumed" : "full handshake"));
   if (code != HTTP_CODE_OK)
   {
-    https.end();
+    g_https.end();
+    g_tlsStats.record(reused, true, before, after, false);
     return false;
   }
-  String payload = https.getString();
-  https.end();
+  payload = g_https.getString();
+  g_https.end(); // socket stays open if the server allows keep-alive
+  g_tlsStats.record(reused, true, before, after, true);
+  (reused ? g_tlsLatReused : g_tlsLatNew).add(millis() - t0);
+  return true;
+}
+
+// report=false: setpoint pull only, the server state (actualTemp, cald) is left alone
+static bool cesanaReportAndFetch(bool report, cdeg_t temp, bool heatingFromAck /* true=ON, false=OFF */)
+{
+  // Only report in STA mode, not in AP
+  if (WiFi.status() != WL_CONNECTED || g_apActive)
+  {
+    return false;
+  }
+
+  String url;
+  if (report)
+  {
+    char tbuf[8];
+    cdeg_format(temp, tbuf, 1);
+    url += "&temp=";
+    url += tbuf;
+    url += "&cald=";
+    url += (heatingFromAck ? "1" : "0");
+  }
+  if (g_schedLoaded)
+  {
+    char sv[16];
+    snprintf(sv, sizeof(sv), "&sv=%08lx", (unsigned long)g_sched.version());
+    url += sv; // matching version: the server leaves AUTO evaluation to the local program
+  }
+  if (url.length())
+    url.setCharAt(0, '?');
+
+  String payload;
+  if (!cesanaGet(url, payload))
+    return false;
 
   JsonDocument doc;
   DeserializationError err = deserializeJson(doc, payload);
@@ -770,37 +2002,380 @@ static bool cesanaReportAndFetch(float tempC, bool heatingFromAck /* true=ON, fa
   }
   g_remoteOk = doc["ok"] | false;
   g_remoteMode = (const char *)(doc["mode"] | "");
-  g_remoteSetpoint = doc["setpoint"] | NAN;
-  g_remoteActual = doc["actualTemp"] | NAN;
-  if (!isnan(g_remoteSetpoint) && !isnan(g_remoteActual))
+  g_remoteSetpoint = cdeg_from_c(doc["setpoint"] | NAN);
+  g_remoteActual = cdeg_from_c(doc["actualTemp"] | NAN);
+  const char *sv = doc["schedule_version"] | "";
+  if (*sv)
+  {
+    g_schedRemoteVer = strtoul(sv, nullptr, 16);
+    g_schedRemoteVerKnown = true;
+  }
+  const bool follow = g_remoteOk && g_remoteMode == "AUTO";
+  if (g_remoteOk && follow != g_schedFollow)
+  {
+    g_schedFollow = follow;
+    if (g_schedLoaded)
+      saveSchedule(); // remember the mode for offline boots
+  }
+  // Next scheduled change (AUTO mode, server-evaluated): drives the optimal start.
+  // With the local program in charge the server sends null and scheduleTick() fills it in.
+  const cdeg_t nextSp = cdeg_from_c(doc["next_setpoint"] | NAN);
+  if (cdeg_valid(nextSp))
+  {
+    g_remoteNextSp = nextSp;
+    g_remoteNextAtMs = millis() + (doc["next_change_s"] | 0UL) * 1000UL;
+    g_remoteNextFetchMs = millis();
+  }
+  else if (!schedLocalActive())
+    g_remoteNextSp = CDEG_INVALID;
+  if (cdeg_valid(g_remoteSetpoint) && cdeg_valid(g_remoteActual))
   {
     g_remoteHeating = (g_remoteActual < g_remoteSetpoint);
-    g_remoteDelta = g_remoteActual - g_remoteSetpoint;
+    g_remoteDelta = (cdeg_t)(g_remoteActual - g_remoteSetpoint);
   }
   else
   {
     g_remoteHeating = false;
-    g_remoteDelta = NAN;
+    g_remoteDelta = CDEG_INVALID;
   }
   Serial.printf("[HTTP] ok=%s mode=%s setpoint=%.1f actual=%.1f heat=%s Δ=%.1f\n",
-                g_remoteOk ? "true" : "false", g_remoteMode.c_str(), g_remoteSetpoint, g_remoteActual,
-                g_remoteHeating ? "ON" : "OFF", (isnan(g_remoteDelta) ? NAN : g_remoteDelta));
+                g_remoteOk ? "true" : "false", g_remoteMode.c_str(),
+                cdeg_valid(g_remoteSetpoint) ? cdeg_to_c(g_remoteSetpoint) : NAN,
+                cdeg_valid(g_remoteActual) ? cdeg_to_c(g_remoteActual) : NAN,
+                g_remoteHeating ? "ON" : "OFF", cdeg_valid(g_remoteDelta) ? cdeg_to_c(g_remoteDelta) : NAN);
 
   // Apply remote setpoint if provided
-  if (g_remoteOk && !isnan(g_remoteSetpoint) && g_remoteSetpoint >= 5.0f && g_remoteSetpoint <= 35.0f)
+  if (g_remoteOk && cdeg_valid(g_remoteSetpoint) && g_remoteSetpoint >= 500 && g_remoteSetpoint <= 3500)
   {
-    if (fabsf(g_remoteSetpoint - g_fixedSetpoint) >= SP_EPS)
+    if (abs(g_remoteSetpoint - g_fixedSetpoint) >= SP_EPS_CD)
     {
       g_fixedSetpoint = g_remoteSetpoint;
       g_fixedPreset = "remote";
       g_fixedEnabled = true;
       saveFixedSetpointIfNeeded(/*force=*/true);
-      Serial.printf("[HTTP] Applied remote SP=%.1f and saved (preset=remote)\n", g_fixedSetpoint);
+      Serial.printf("[HTTP] Applied remote SP=%.1f and saved (preset=remote)\n", cdeg_to_c(g_fixedSetpoint));
     }
   }
   return g_remoteOk;
 }
 
+// ===== Local weekly schedule =====
+// Fetch the compact program (get_setpoint.php?schedule=1) and persist it
+static bool cesanaFetchSchedule()
+{
+  String payload;
+  if (!cesanaGet("?schedule=1", payload))
+    return false;
+  JsonDocument doc;
+  if (deserializeJson(doc, payload) || !(doc["ok"] | false))
+  {
+    Serial.println("[SCHED] Bad schedule reply");
+    return false;
+  }
+  WeekSchedule ws;
+  ws.clear(strtoul(doc["version"] | "0", nullptr, 16), cdeg_from_c(doc["manual"] | NAN));
+  JsonArray days = doc["days"];
+  bool ok = days.size() == 7 && cdeg_valid(ws.manual());
+  for (uint8_t d = 0; ok && d < 7; ++d)
+    for (JsonArray sl : days[d].as<JsonArray>())
+    {
+      const int m = sl[0] | -1;
+      if (!ws.add(d, (uint16_t)(m < 0 ? WeekSchedule::MIN_PER_DAY : m), cdeg_from_c(sl[1] | NAN)))
+      {
+        ok = false; // full, unsorted or out of range: keep the old copy
+        break;
+      }
+    }
+  if (!ok)
+  {
+    Serial.println("[SCHED] Schedule rejected");
+    return false;
+  }
+  g_sched = ws;
+  g_schedLoaded = true;
+  saveSchedule();
+  Serial.printf("[SCHED] Synced version %08lx, %u slots\n", (unsigned long)g_sched.version(), g_sched.count());
+  return true;
+}
+
+static void scheduleSyncTick()
+{
+  if (!g_schedRemoteVerKnown || (g_schedLoaded && g_sched.version() == g_schedRemoteVer))
+    return;
+  if (WiFi.status() != WL_CONNECTED || g_apActive || (int32_t)(millis() - g_schedSyncAtMs) < 0)
+    return;
+  if (cesanaFetchSchedule())
+    g_schedSyncs++;
+  else
+  {
+    g_schedSyncFails++;
+    g_schedSyncAtMs = millis() + SCHED_RETRY_MS;
+  }
+}
+
+// Evaluate the local program once per second: setpoint now + next change for the optimal start
+static void scheduleTick()
+{
+  static uint32_t last = 0;
+  if (millis() - last < 1000)
+    return;
+  last = millis();
+  if (!schedLocalActive())
+  {
+    g_schedSetpoint = CDEG_INVALID;
+    return;
+  }
+  const time_t now = time(nullptr);
+  struct tm lt;
+  localtime_r(&now, &lt);
+  const uint16_t m = week_minute(lt.tm_wday, lt.tm_hour, lt.tm_min);
+  g_schedSetpoint = g_sched.at(m);
+
+  uint16_t inMin;
+  cdeg_t nextSp;
+  if (g_sched.nextChange(m, inMin, nextSp))
+  {
+    g_remoteNextSp = nextSp;
+    g_remoteNextAtMs = millis() + ((uint32_t)inMin * 60UL - (uint32_t)lt.tm_sec) * 1000UL;
+    g_remoteNextFetchMs = millis();
+  }
+  else
+    g_remoteNextSp = CDEG_INVALID;
+
+  if (g_schedSetpoint >= 500 && g_schedSetpoint <= 3500 && abs(g_schedSetpoint - g_fixedSetpoint) >= SP_EPS_CD)
+  {
+    g_fixedSetpoint = g_schedSetpoint;
+    g_fixedPreset = "schedule";
+    g_fixedEnabled = true;
+    saveFixedSetpointIfNeeded(/*force=*/true);
+    Serial.printf("[SCHED] Local program -> SP=%.1f\n", cdeg_to_c(g_fixedSetpoint));
+  }
+}
+
+// ===== Control helper =====
+static cdeg_t getActiveSetpoint() { return g_fixedEnabled ? g_fixedSetpoint : 1900; }
+// Zone 0 follows the remote schedule and heats ahead of it while the optimal start is active
+static cdeg_t zoneSetpoint(uint8_t zi)
+{
+  if (zi != 0)
+    return g_zones[zi].setpoint;
+  return g_preheatActive ? g_remoteNextSp : getActiveSetpoint();
+}
+
+// Optimal start: lead = fixed 10 min dead time (RATE_DEAD_MS) + (next sp - temp) / learned heating
+// rate. Latched once started, until the change time (plus grace) passes or the schedule info
+// goes stale.
+static void preheatTick(uint32_t now)
+{
+  const Zone &z0 = g_zones[0];
+  const bool fresh = cdeg_valid(g_remoteNextSp) && now - g_remoteNextFetchMs < PREHEAT_FRESH_MS;
+  const int32_t left = (int32_t)(g_remoteNextAtMs - now);
+  bool want = false;
+  g_preheatLeadMs = 0;
+  if (fresh && g_remoteNextSp > getActiveSetpoint() && left > -(int32_t)PREHEAT_GRACE_MS)
+  {
+    g_preheatLeadMs = z0.learn.preheatMs(z0.temp, g_remoteNextSp, PREHEAT_MAX_MS);
+    want = g_preheatActive || (g_preheatLeadMs && left <= (int32_t)g_preheatLeadMs);
+  }
+  if (want == g_preheatActive)
+    return;
+  g_preheatActive = want;
+  if (want)
+  {
+    g_preheatStarts++;
+    Serial.printf("[PREHEAT] Heating to %.1f now, change in %ld min (lead %lu min)\n", cdeg_to_c(g_remoteNextSp),
+                  (long)(left / 60000), (unsigned long)(g_preheatLeadMs / 60000));
+  }
+  else
+    Serial.println("[PREHEAT] Done");
+}
+
+// UI boundary: 0.01 °C -> JSON number in °C (null when there is no value)
+template <typename Slot> // doc["key"] / o["key"] proxy
+static void jsonTemp(Slot v, cdeg_t t)
+{
+  if (cdeg_valid(t))
+    v = cdeg_to_c(t);
+  else
+    v = nullptr;
+}
+
+// ===== ESP-NOW relay pairing =====
+static void espnowAddPeer(uint8_t *mac)
+{
+  if (esp_now_is_peer_exist(mac))
+    return;
+  int rc = esp_now_add_peer(mac, ESP_NOW_ROLE_COMBO, g_espnowChannel, NULL, 0);
+  Serial.print("[TX] add_peer(");
+  printMac(mac);
+  Serial.printf(") -> %d\n", rc);
+}
+
+static void relayPairingTick()
+{
+  if (g_zoneLearnPending == 0xFF)
+    return;
+  Zone &z = g_zones[g_zoneLearnPending];
+  memcpy(z.relayMac, g_zoneLearnMac, 6);
+  z.paired = true; // unicast from now on
+  Serial.printf("[PAIR] Zone %u relay learned: ", g_zoneLearnPending);
+  printMac(z.relayMac);
+  Serial.println(" -> unicast");
+  g_zoneLearnPending = 0xFF;
+  espnowAddPeer(z.relayMac);
+  saveZones();
+}
+
+static void relayUnpair(uint8_t zi)
+{
+  Zone &z = g_zones[zi];
+  if (!z.paired)
+    return;
+  z.paired = false; // back to discovery via broadcast
+  if (zoneByMac(z.relayMac) < 0 && esp_now_is_peer_exist(z.relayMac))
+    esp_now_del_peer(z.relayMac); // no other zone on this relay board
+  saveZones();
+  Serial.printf("[PAIR] Zone %u relay forgotten, discovery via broadcast\n", zi);
+}
+
+// ===== ESP-NOW channel manager =====
+// - Follows the radio channel (STA reconnect on another router channel, AP fallback) and
+//   re-registers every peer on it, so commands keep reaching the relays.
+// - When a paired relay stops answering and we are not bound to a router (STA down), sweep
+//   channels 1..13 with probe frames; stay where the first ACK comes back.
+// - Per zone, link loss (down, or the channel moved under it) -> that zone's first ACK while still
+//   down is measured as the recovery time; other zones' heartbeats end neither a sweep nor a recovery.
+static const uint32_t CH_SCAN_DWELL_MS = 80;     // per channel, well above ACK RTT
+static const uint32_t CH_SCAN_RETRY_MS = 30000;  // between failed sweeps
+static const uint8_t CH_MAX = 13;
+static bool g_chScanActive = false;
+static uint8_t g_chScanCh = 0;
+static uint8_t g_chScanOrigin = 1;
+static uint32_t g_chScanDwellUntil = 0;
+static uint32_t g_chNextScanMs = 0;
+static uint32_t g_chChanges = 0;
+static uint32_t g_chScans = 0;
+static uint32_t g_chRecoveries = 0;
+static uint32_t g_chRecoverLastMs = 0;
+static uint32_t g_chRecoverMaxMs = 0;
+
+static void chRetunePeers(uint8_t ch)
+{
+  g_espnowChannel = ch;
+  esp_now_set_peer_channel(BROADCAST_MAC, ch);
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    if (g_zones[i].used && g_zones[i].paired)
+      esp_now_set_peer_channel(g_zones[i].relayMac, ch);
+}
+
+static void chMarkLinkLost(Zone &z, uint32_t now)
+{
+  if (z.chLost)
+    return;
+  z.chLost = true;
+  z.chLostAtMs = now;
+}
+
+static uint8_t chZonesLost()
+{
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    n += g_zones[i].used && g_zones[i].chLost ? 1 : 0;
+  return n;
+}
+
+// Matched ACK from zone z. Only a zone whose link is down ends a scan (its relay answered on this
+// channel) and closes its recovery window; a zone that stayed up through a channel move just clears it.
+static void chNoteAck(Zone &z, uint32_t atMs)
+{
+  if (!z.link.down())
+  {
+    z.chLost = false;
+    return;
+  }
+  if (g_chScanActive)
+  {
+    g_chScanActive = false;
+    g_chNextScanMs = atMs + CH_SCAN_RETRY_MS; // the link needs a few more ACKs to count as up again
+    Serial.printf("[CH] Relay found on channel %u\n", g_espnowChannel);
+    if (g_apActive && g_apChannel != g_espnowChannel)
+    {
+      g_apChannel = g_espnowChannel; // keep the AP UI on the relay's channel
+      WiFi.softAP(AP_SSID, AP_PASS, g_apChannel);
+    }
+  }
+  if (z.chLost)
+  {
+    z.chLost = false;
+    uint32_t rec = atMs - z.chLostAtMs;
+    g_chRecoveries++;
+    g_chRecoverLastMs = rec;
+    if (rec > g_chRecoverMaxMs)
+      g_chRecoverMaxMs = rec;
+    Serial.printf("[CH] Zone %u link recovered in %lu ms\n", (unsigned)(&z - g_zones), (unsigned long)rec);
+  }
+}
+
+static void chScanProbe()
+{
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    if (g_zones[i].used && g_zones[i].paired && g_zones[i].link.down())
+      espnowSendProbe(g_zones[i]);
+}
+
+static void channelTick()
+{
+  uint32_t now = millis();
+
+  if (g_chScanActive)
+  {
+    if ((int32_t)(now - g_chScanDwellUntil) < 0)
+      return; // still listening on this channel
+    if (++g_chScanCh > CH_MAX)
+    {
+      g_chScanActive = false;
+      wifi_set_channel(g_chScanOrigin);
+      chRetunePeers(g_chScanOrigin);
+      g_chNextScanMs = now + CH_SCAN_RETRY_MS;
+      Serial.printf("[CH] Sweep found no relay, back on channel %u\n", g_chScanOrigin);
+      return;
+    }
+    wifi_set_channel(g_chScanCh);
+    chRetunePeers(g_chScanCh);
+    chScanProbe();
+    g_chScanDwellUntil = now + CH_SCAN_DWELL_MS;
+    return;
+  }
+
+  // Radio moved underneath us (AP fallback, STA reconnect) -> re-register peers
+  uint8_t cur = wifi_get_channel();
+  if (cur >= 1 && cur <= CH_MAX && cur != g_espnowChannel)
+  {
+    Serial.printf("[CH] Radio channel %u -> %u, re-registering peers\n", g_espnowChannel, cur);
+    chRetunePeers(cur);
+    g_chChanges++;
+    for (uint8_t i = 0; i < MAX_ZONES; ++i)
+      if (g_zones[i].used && g_zones[i].paired)
+        chMarkLinkLost(g_zones[i], now);
+  }
+
+  bool anyDown = false;
+  for (uint8_t i = 0; i < MAX_ZONES && !anyDown; ++i)
+    anyDown = g_zones[i].used && g_zones[i].paired && g_zones[i].link.down();
+  if (!anyDown)
+    return;
+
+  // A router fixes our channel; only sweep when STA is not associated
+  if (WiFi.status() == WL_CONNECTED || (int32_t)(now - g_chNextScanMs) < 0)
+    return;
+  g_chScanActive = true;
+  g_chScanOrigin = g_espnowChannel;
+  g_chScanCh = 0;
+  g_chScanDwellUntil = now; // first channel on the next tick
+  g_chScans++;
+  Serial.println("[CH] Relay silent -> sweeping channels 1..13");
+}
+
 // ===== Web handlers =====
 void handleIndex()
 {
@@ -817,7 +2392,7 @@ void handleWifiPage()
 void handleGetFixed()
 {
   JsonDocument doc;
-  doc["setpoint"] = g_fixedSetpoint;
+  jsonTemp(doc["setpoint"], g_fixedSetpoint);
   doc["preset"] = g_fixedPreset;
   doc["enabled"] = g_fixedEnabled;
   String out;
@@ -853,21 +2428,21 @@ void handlePostFixed()
   {
     if (p == "off")
     {
-      g_fixedSetpoint = 10.0f;
+      g_fixedSetpoint = 1000;
       g_fixedPreset = "off";
       g_fixedEnabled = true;
       return true;
     }
     if (p == "on")
     {
-      g_fixedSetpoint = 19.0f;
+      g_fixedSetpoint = 1900;
       g_fixedPreset = "on";
       g_fixedEnabled = true;
       return true;
     }
     if (p == "away")
     {
-      g_fixedSetpoint = 15.0f;
+      g_fixedSetpoint = 1500;
       g_fixedPreset = "away";
       g_fixedEnabled = true;
       return true;
@@ -879,8 +2454,8 @@ void handlePostFixed()
     changed = applyPreset(preset);
   else
   {
-    float sp = in["setpoint"] | NAN;
-    if (!isnan(sp) && sp >= 5.0f && sp <= 35.0f)
+    cdeg_t sp = cdeg_from_c(in["setpoint"] | NAN);
+    if (cdeg_valid(sp) && sp >= 500 && sp <= 3500)
     {
       g_fixedSetpoint = sp;
       g_fixedPreset = "custom";
@@ -898,7 +2473,7 @@ void handlePostFixed()
 
   JsonDocument out;
   out["ok"] = ok;
-  out["setpoint"] = g_fixedSetpoint;
+  jsonTemp(out["setpoint"], g_fixedSetpoint);
   out["preset"] = g_fixedPreset;
   out["enabled"] = g_fixedEnabled;
   String s;
@@ -919,43 +2494,247 @@ void handleTime()
 void handleStatus()
 {
   time_t now = time(nullptr);
-  float sp = g_fixedEnabled ? g_fixedSetpoint : 19.0f;
+  const Zone &z0 = g_zones[0];
+  cdeg_t sp = getActiveSetpoint();
 
   // UI action: prefer ACK relay state when available, else local decision
-  uint8_t actionForUi = g_haveAck ? (g_ackRelayOn ? 1 : 0) : g_lastAction;
+  uint8_t actionForUi = z0.haveAck ? (z0.ackRelayOn ? 1 : 0) : z0.action;
 
   JsonDocument doc;
   doc["epoch"] = (uint32_t)now;
-  if (isnan(g_lastTempC))
-    doc["temp"] = nullptr;
-  else
-    doc["temp"] = g_lastTempC;
-  doc["setpoint"] = sp;
+  jsonTemp(doc["temp"], z0.temp);
+  jsonTemp(doc["setpoint"], sp);
   doc["preset"] = g_fixedPreset;
   doc["action"] = actionForUi; // drives Heat ON/OFF badge
-  doc["hysteresis"] = HYST_BAND_C;
+  doc["hysteresis"] = cdeg_to_c(HYST_BAND_CD);
+  doc["controller"] = ctlModeName(g_ctlMode);
+
+  // Local weekly program (mirror of the server schedule)
+  JsonObject sc = doc["schedule"].to<JsonObject>();
+  sc["loaded"] = g_schedLoaded;
+  sc["follow"] = g_schedFollow;
+  sc["local"] = schedLocalActive();
+  char ver[12];
+  snprintf(ver, sizeof(ver), "%08lx", (unsigned long)g_sched.version());
+  if (g_schedLoaded)
+    sc["version"] = String(ver);
+  else
+    sc["version"] = nullptr;
+  snprintf(ver, sizeof(ver), "%08lx", (unsigned long)g_schedRemoteVer);
+  if (g_schedRemoteVerKnown)
+    sc["serverVersion"] = String(ver);
+  else
+    sc["serverVersion"] = nullptr;
+  sc["slots"] = g_sched.count();
+  jsonTemp(sc["setpoint"], g_schedSetpoint);
+  sc["syncs"] = g_schedSyncs;
+  sc["syncFails"] = g_schedSyncFails;
+
+  // Remote HTTPS link: keep-alive reuse, handshakes, session resumption, latency
+  JsonObject rc = doc["cesana"].to<JsonObject>();
+  rc["host"] = CESANA_HOST;
+  rc["port"] = CESANA_PORT;
+  rc["requests"] = g_tlsStats.requests();
+  rc["fails"] = g_tlsStats.fails();
+  rc["reused"] = g_tlsStats.reused();
+  rc["reuseRate"] = g_tlsStats.reusePermille() / 1000.0f;
+  rc["handshakes"] = g_tlsStats.handshakes();
+  rc["resumed"] = g_tlsStats.resumed();
+  rc["resumeRate"] = g_tlsStats.resumePermille() / 1000.0f;
+  JsonObject lat = rc["latencyReusedMs"].to<JsonObject>();
+  lat["last"] = g_tlsLatReused.last;
+  lat["avg"] = g_tlsLatReused.avg();
+  lat["max"] = g_tlsLatReused.max;
+  lat = rc["latencyNewMs"].to<JsonObject>();
+  lat["last"] = g_tlsLatNew.last;
+  lat["avg"] = g_tlsLatNew.avg();
+  lat["max"] = g_tlsLatNew.max;
+  // Change-driven reporting: requests by trigger, what the server last got
+  JsonObject rp = rc["report"].to<JsonObject>();
+  for (uint8_t r = RR_FIRST; r < RR_COUNT; ++r)
+    rp[report_reason_name(r)] = g_report.count(r);
+  rp["fails"] = g_report.fails();
+  jsonTemp(rp["sentTemp"], g_report.sentTemp());
+  rp["sentCald"] = g_report.sentCald();
+  if (g_report.sent())
+    rp["sentAgoS"] = (millis() - g_report.sentMs()) / 1000;
+
+  // Optimal start toward the next scheduled change (zone 0)
+  JsonObject ph = doc["preheat"].to<JsonObject>();
+  ph["active"] = g_preheatActive;
+  jsonTemp(ph["next"], g_remoteNextSp);
+  if (cdeg_valid(g_remoteNextSp))
+    ph["inS"] = (int32_t)(g_remoteNextAtMs - millis()) / 1000;
+  ph["leadS"] = g_preheatLeadMs / 1000;
+  ph["starts"] = g_preheatStarts;
 
   // ACK/Caldaia info
-  doc["ackAvailable"] = g_haveAck;
-  if (g_haveAck)
-    doc["ackAgeMs"] = (uint32_t)(millis() - g_ackLastMs);
+  doc["ackAvailable"] = z0.haveAck;
+  if (z0.haveAck)
+    doc["ackAgeMs"] = (uint32_t)(millis() - z0.ackLastMs);
+  doc["ackStaleMs"] = ACK_STALE_MS;
+
+  // Every active zone (zone 0 = the fields above)
+  JsonArray zs = doc["zones"].to<JsonArray>();
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+  {
+    const Zone &z = g_zones[i];
+    if (!z.used)
+      continue;
+    JsonObject o = zs.add<JsonObject>();
+    o["zone"] = i;
+    o["relayId"] = z.relayId;
+    jsonTemp(o["temp"], z.temp);
+    jsonTemp(o["setpoint"], zoneSetpoint(i));
+    o["action"] = z.action;
+    o["heater"] = z.heaterOn;
+    o["agg"] = zoneAggName(z.sensorAgg);
+    if (g_ctlMode == CTL_TPI)
+    {
+      JsonObject c = o["tpi"].to<JsonObject>();
+      c["duty"] = z.tpi.dutyPermille() / 1000.0f;
+      c["p"] = z.tpi.pTermPermille() / 1000.0f;
+      c["i"] = z.tpi.iTermPermille() / 1000.0f;
+      c["onMs"] = z.tpi.onMs();
+      c["cycleMs"] = g_tpiCfg.cycleMs;
+      c["minPulseMs"] = tpiRunConfig().minPulseMs; // minPulseS raised to minOnS/minOffS
+      c["cyclePosMs"] = z.tpi.cycleElapsedMs(millis());
+      c["cycles"] = z.tpi.cycles();
+    }
+    o["forcedOff"] = z.out.state() == HS_COOLDOWN;
+    JsonObject ho = o["output"].to<JsonObject>();
+    ho["state"] = heaterStateName(z.out.state());
+    ho["inStateS"] = z.out.inStateMs(millis()) / 1000;
+    ho["cycles"] = z.out.cycles();
+    ho["cooldowns"] = z.out.cooldowns();
+    ho["forcedOffs"] = z.out.forcedOffs();
+    ho["heldOn"] = z.out.heldOn();
+    ho["heldOff"] = z.out.heldOff();
+    ho["onS"] = (uint32_t)(z.out.timeInMs(HS_ON) / 1000);
+    ho["offS"] = (uint32_t)(z.out.timeInMs(HS_OFF) / 1000);
+    ho["cooldownS"] = (uint32_t)(z.out.timeInMs(HS_COOLDOWN) / 1000);
+    JsonObject lr = o["learn"].to<JsonObject>(); // °C per minute, null until learned
+    if (z.learn.known(true))
+      lr["heatPerMin"] = z.learn.heatCdPerH() / 6000.0f;
+    else
+      lr["heatPerMin"] = nullptr;
+    if (z.learn.known(false))
+      lr["coolPerMin"] = z.learn.coolCdPerH() / 6000.0f;
+    else
+      lr["coolPerMin"] = nullptr;
+    lr["heatSegs"] = z.learn.state().heatSegs;
+    lr["coolSegs"] = z.learn.state().coolSegs;
+    lr["stretchS"] = z.learn.stretchS();
+    lr["stretchHeat"] = z.learn.stretchHeating();
+    o["paired"] = z.paired;
+    if (z.paired)
+    {
+      char mac[18];
+      formatMac(z.relayMac, mac);
+      o["relay"] = mac;
+    }
+    else
+      o["relay"] = nullptr;
+    o["link"] = z.link.permille() / 1000.0f;
+    o["linkDown"] = z.link.down();
+    o["linkDownEvents"] = z.link.downEvents();
+    o["arqRetries"] = z.arq.retries();
+    o["arqGiveUps"] = z.arq.giveUps();
+    o["ackAvailable"] = z.haveAck;
+    if (z.haveAck)
+    {
+      o["ackRelay"] = z.ackRelayOn ? 1 : 0;
+      o["ackAgeMs"] = (uint32_t)(millis() - z.ackLastMs);
+    }
+  }
+
+  // ESP-NOW command path counters
+  JsonObject en = doc["espnow"].to<JsonObject>();
+  en["binary"] = g_txBinary;
+  en["channel"] = g_espnowChannel;
+  en["frames"] = g_txFrames;
+  en["framesThisHour"] = g_txFramesThisHour;
+  en["framesLastHour"] = g_txFramesLastHour;
+  en["changes"] = g_cmdChanges;
+  en["ackLatLastMs"] = g_ackLatLastMs;
+  en["ackLatAvgMs"] = g_ackLatCount ? g_ackLatSumMs / g_ackLatCount : 0;
+  en["ackLatMaxMs"] = g_ackLatMaxMs;
+  en["txStatusOk"] = g_txStatusOk;
+  en["txStatusErr"] = g_txStatusErr;
+  en["rxFrames"] = g_rxFrames;
+  en["rxOverflows"] = g_rxRing.overflows();
+  en["rxOversize"] = g_rxOversize;
+  en["rxHighWater"] = g_rxRing.highWater();
+  en["rxCapacity"] = g_rxRing.capacity();
+
+  // DS18B20 driver counters
+  JsonObject ds = doc["ds18b20"].to<JsonObject>();
+  ds["resolution"] = g_ds.resolution();
+  ds["tconvMs"] = g_ds.conversionMs();
+  ds["resChanges"] = g_dsResChanges;
+  ds["samples"] = g_dsSamples;
+  ds["rateHz"] = roundf(g_dsRateHz * 100) / 100;
+  ds["sampleAgeMs"] = g_dsSamples ? millis() - g_dsSampleAtMs : 0;
+  ds["jitterLastMs"] = g_dsJitter.last;
+  ds["jitterAvgMs"] = g_dsJitter.avg();
+  ds["jitterMaxMs"] = g_dsJitter.max;
+  ds["ageAtDecisionLastMs"] = g_dsAgeAtDecision.last;
+  ds["ageAtDecisionAvgMs"] = g_dsAgeAtDecision.avg();
+  ds["ageAtDecisionMaxMs"] = g_dsAgeAtDecision.max;
+
+  JsonObject fl = ds["filter"].to<JsonObject>();
+  uint32_t acc = 0, rej = 0, rst = 0;
+  uint16_t lagMax = 0;
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+  {
+    const TempFilter<TEMP_FILTER_N> &f = g_sensors[i].filter;
+    acc += f.accepted();
+    rej += f.rejected();
+    rst += f.restarts();
+    if (f.lagMaxCd() > lagMax)
+      lagMax = f.lagMaxCd();
+  }
+  const uint8_t lagSamples = TempFilter<TEMP_FILTER_N>::lagSamples(g_filterCfg);
+  fl["window"] = TEMP_FILTER_N;
+  fl["spikeC"] = cdeg_to_c(g_filterCfg.spikeCd);
+  fl["emaShift"] = g_filterCfg.emaShift;
+  fl["lagSamples"] = lagSamples;
+  fl["lagMs"] = g_dsRateHz > 0 ? (uint32_t)(lagSamples * 1000 / g_dsRateHz) : 0;
+  fl["lagMaxC"] = cdeg_to_c(lagMax);
+  fl["accepted"] = acc;
+  fl["rejected"] = rej;
+  fl["restarts"] = rst;
+
+  JsonObject hp = ds["hotplug"].to<JsonObject>();
+  hp["present"] = ds_present_count();
+  hp["known"] = g_sensorCount;
+  hp["scans"] = g_hpScans;
+  hp["scanUsTotal"] = g_hpUsTotal;
+  hp["scanUsLast"] = g_hpScans ? g_hpLastCostUs : 0;
+  hp["budgetSkips"] = g_hpBudgetSkips;
+  hp["backoffMs"] = g_hpBackoffMs;
+  hp["appeared"] = g_dsAppeared;
+  hp["lost"] = g_dsLost;
+  ds["parasite"] = g_ds.parasite();
+  ds["conversions"] = g_ds.conversions();
+  ds["reads"] = g_ds.reads();
+  ds["crcErrors"] = g_ds.crcErrors();
+  ds["disconnects"] = g_ds.disconnects();
+  ds["alarmMode"] = (bool)DS_ALARM_MODE;
+  if (DS_ALARM_MODE)
+  {
+    ds["alarmSearches"] = g_ds.alarmSearches();
+    ds["alarmHits"] = g_ds.alarmHits();
+    ds["alarmWrites"] = g_ds.alarmWrites();
+  }
 
   // Remote (unchanged)
-  if (isnan(g_remoteSetpoint))
-    doc["remoteSetpoint"] = nullptr;
-  else
-    doc["remoteSetpoint"] = g_remoteSetpoint;
+  jsonTemp(doc["remoteSetpoint"], g_remoteSetpoint);
   if (g_remoteMode.length())
     doc["remoteMode"] = g_remoteMode;
-  if (isnan(g_remoteActual))
-    doc["remoteActual"] = nullptr;
-  else
-    doc["remoteActual"] = g_remoteActual;
+  jsonTemp(doc["remoteActual"], g_remoteActual);
   doc["remoteHeating"] = g_remoteHeating;
-  if (isnan(g_remoteDelta))
-    doc["remoteDelta"] = nullptr;
-  else
-    doc["remoteDelta"] = g_remoteDelta;
+  jsonTemp(doc["remoteDelta"], g_remoteDelta);
 
   // Wi-Fi status + AP info
   JsonObject w = doc["wifi"].to<JsonObject>();
@@ -982,29 +2761,398 @@ void handleStatus()
   server.send(200, "application/json", out);
 }
 
-// Quick 1-Wire bus inspection (debug)
-void handleOwBus()
+void handleEspnowUnpair()
+{
+  int zi = server.hasArg("zone") ? server.arg("zone").toInt() : 0;
+  if (zi < 0 || zi >= MAX_ZONES)
+  {
+    server.send(422, "application/json", "{\"ok\":false,\"err\":\"zone\"}");
+    return;
+  }
+  relayUnpair((uint8_t)zi);
+  server.send(200, "application/json", "{\"ok\":true}");
+}
+
+// ESP-NOW delivery stats: seq-correlated ACKs, loss, RTT histogram
+void handleEspnowStats()
 {
-  sensors.requestTemperatures();
-  delay(5);
   JsonDocument doc;
-  JsonArray arr = doc["devices"].to<JsonArray>();
-  uint8_t count = sensors.getDeviceCount();
-  for (uint8_t i = 0; i < count; i++)
+  doc["sent"] = g_inflight.sent();
+  doc["acked"] = g_inflight.acked();
+  doc["lost"] = g_inflight.lost();
+  doc["duplicate"] = g_inflight.duplicates();
+  doc["stale"] = g_inflight.stale();
+  doc["uncorrelated"] = g_ackUncorrelated;
+  doc["inflight"] = g_inflight.pending();
+  doc["lossRate"] = g_inflight.lossPermille() / 1000.0f;
+  doc["ackTimeoutMs"] = ACK_TIMEOUT_MS;
+
+  JsonObject ch = doc["channel"].to<JsonObject>();
+  ch["current"] = g_espnowChannel;
+  ch["changes"] = g_chChanges;
+  ch["scans"] = g_chScans;
+  ch["scanning"] = g_chScanActive;
+  ch["linkLost"] = chZonesLost(); // zones not yet recovered
+  ch["recoveries"] = g_chRecoveries;
+  ch["recoverLastMs"] = g_chRecoverLastMs;
+  ch["recoverMaxMs"] = g_chRecoverMaxMs;
+
+  JsonObject r = doc["rtt"].to<JsonObject>();
+  r["count"] = g_rtt.total();
+  r["p50"] = g_rtt.percentileMs(50);
+  r["p90"] = g_rtt.percentileMs(90);
+  r["p99"] = g_rtt.percentileMs(99);
+  r["max"] = g_rtt.maxMs();
+  JsonArray b = r["buckets"].to<JsonArray>();
+  for (uint8_t i = 0; i < RttHistogram::BUCKETS; ++i)
+  {
+    JsonObject o = b.add<JsonObject>();
+    if (i < RttHistogram::BUCKETS - 1)
+      o["le"] = RttHistogram::upperMs(i);
+    else
+      o["le"] = nullptr; // open-ended
+    o["n"] = g_rtt.count(i);
+  }
+
+  String out;
+  serializeJson(doc, out);
+  server.send(200, "application/json", out);
+}
+
+// Zone table: GET lists config, POST {"zone":n,"used":b,"relayId":n,"sensor":"28:..."|"","setpoint":x,
+//                                     "agg":"control"|"min"|"mean","sensors":[table indices]}
+void handleGetZones()
+{
+  JsonDocument doc;
+  doc["max"] = MAX_ZONES;
+  JsonArray arr = doc["zones"].to<JsonArray>();
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+  {
+    const Zone &z = g_zones[i];
+    JsonObject o = arr.add<JsonObject>();
+    o["zone"] = i;
+    o["used"] = z.used;
+    o["relayId"] = z.relayId;
+    jsonTemp(o["setpoint"], zoneSetpoint(i));
+    if (zoneRomIsPrimary(z))
+      o["sensor"] = nullptr; // first sensor on the bus
+    else
+    {
+      char rom[24];
+      formatRom(z.sensorRom, rom);
+      o["sensor"] = rom;
+    }
+    o["agg"] = zoneAggName(z.sensorAgg);
+    JsonArray m = o["sensors"].to<JsonArray>(); // empty -> every present sensor
+    for (uint8_t k = 0; k < MAX_SENSORS; ++k)
+      if (z.sensorMask & (1u << k))
+        m.add(k);
+    o["paired"] = z.paired;
+  }
+  String out;
+  serializeJson(doc, out);
+  server.send(200, "application/json", out);
+}
+
+void handlePostZones()
+{
+  if (!server.hasArg("plain"))
+  {
+    server.send(400, "text/plain", "Missing body");
+    return;
+  }
+  JsonDocument in;
+  DeserializationError e = deserializeJson(in, server.arg("plain"));
+  if (e)
+  {
+    server.send(400, "text/plain", String("JSON error: ") + e.c_str());
+    return;
+  }
+  int zi = in["zone"] | -1;
+  if (zi < 0 || zi >= MAX_ZONES)
+  {
+    server.send(422, "application/json", "{\"ok\":false,\"err\":\"zone\"}");
+    return;
+  }
+  Zone &z = g_zones[zi];
+
+  int relayId = in["relayId"] | (int)z.relayId;
+  if (relayId < 0 || relayId > 255 || (relayId != z.relayId && zoneByRelayId((uint8_t)relayId) >= 0))
+  {
+    server.send(422, "application/json", "{\"ok\":false,\"err\":\"relayId\"}");
+    return;
+  }
+  if (relayId != z.relayId)
+  {
+    relayUnpair((uint8_t)zi); // different relay -> pair again on its first ACK
+    z.relayId = (uint8_t)relayId;
+  }
+
+  if (!in["sensor"].isNull())
   {
-    DeviceAddress a{};
-    if (sensors.getAddress(a, i))
+    const char *rom = in["sensor"] | "";
+    uint8_t r[8] = {0};
+    if (rom[0] && !parseHexBytes(rom, r, 8))
     {
-      char s[24];
-      int p = 0;
-      for (int k = 0; k < 8; k++)
-        p += sprintf(s + p, "%02X%s", a[k], (k < 7 ? ":" : ""));
-      arr.add(s);
+      server.send(422, "application/json", "{\"ok\":false,\"err\":\"sensor\"}");
+      return;
     }
+    memcpy(z.sensorRom, r, 8);
+    z.temp = CDEG_INVALID; // wait for a reading from the new sensor
+  }
+
+  if (!in["agg"].isNull())
+  {
+    String agg = in["agg"] | "";
+    if (agg == "control")
+      z.sensorAgg = ZA_CONTROL;
+    else if (agg == "min")
+      z.sensorAgg = ZA_MIN;
+    else if (agg == "mean")
+      z.sensorAgg = ZA_MEAN;
     else
-      arr.add(nullptr);
+    {
+      server.send(422, "application/json", "{\"ok\":false,\"err\":\"agg\"}");
+      return;
+    }
+  }
+  if (!in["sensors"].isNull())
+  {
+    uint8_t mask = 0;
+    for (JsonVariant v : in["sensors"].as<JsonArray>())
+    {
+      int k = v | -1;
+      if (k < 0 || k >= MAX_SENSORS)
+      {
+        server.send(422, "application/json", "{\"ok\":false,\"err\":\"sensors\"}");
+        return;
+      }
+      mask |= (uint8_t)(1u << k);
+    }
+    z.sensorMask = mask;
+  }
+
+  cdeg_t sp = cdeg_from_c(in["setpoint"] | NAN);
+  if (zi != 0 && cdeg_valid(sp) && sp >= 500 && sp <= 3500)
+    z.setpoint = sp;
+
+  bool wasUsed = z.used;
+  z.used = (zi == 0) ? true : (in["used"] | z.used);
+  if (wasUsed && !z.used)
+  {
+    z.heaterOn = false; // last word to a retired relay is OFF
+    espnowSendHeater(z, false);
+  }
+
+  bool ok = saveZones();
+  server.send(ok ? 200 : 500, "application/json", ok ? "{\"ok\":true}" : "{\"ok\":false}");
+}
+
+// Sensor table: GET lists every known DS18B20, POST {"rom":"28:..","label":"..."} renames,
+// POST {"rom":"28:..","forget":true} drops an absent one (zone masks are re-indexed; 409 "zone"
+// while a zone's control sensor is this ROM, or it is the only sensor left in a min/mean set)
+void handleGetSensors()
+{
+  const uint32_t now = millis();
+  JsonDocument doc;
+  doc["max"] = MAX_SENSORS;
+  JsonArray arr = doc["sensors"].to<JsonArray>();
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+  {
+    const DsSensor &sn = g_sensors[i];
+    JsonObject o = arr.add<JsonObject>();
+    char rom[24];
+    formatRom(sn.rom, rom);
+    o["index"] = i;
+    o["rom"] = rom;
+    o["label"] = sn.label;
+    o["present"] = sn.present;
+    jsonTemp(o["temp"], sn.temp);
+    jsonTemp(o["raw"], sn.rawTemp);
+    if (cdeg_valid(sn.temp))
+      o["ageMs"] = now - sn.readMs;
+    o["rejected"] = sn.filter.rejected();
+    o["lagMaxC"] = cdeg_to_c(sn.filter.lagMaxCd());
   }
-  doc["parasite"] = sensors.isParasitePowerMode();
+  String out;
+  serializeJson(doc, out);
+  server.send(200, "application/json", out);
+}
+
+void handlePostSensors()
+{
+  if (!server.hasArg("plain"))
+  {
+    server.send(400, "text/plain", "Missing body");
+    return;
+  }
+  JsonDocument in;
+  DeserializationError e = deserializeJson(in, server.arg("plain"));
+  if (e)
+  {
+    server.send(400, "text/plain", String("JSON error: ") + e.c_str());
+    return;
+  }
+  uint8_t r[8];
+  int8_t si = parseHexBytes(in["rom"] | "", r, 8) ? sensorByRom(r) : -1;
+  if (si < 0)
+  {
+    server.send(404, "application/json", "{\"ok\":false,\"err\":\"rom\"}");
+    return;
+  }
+
+  if (in["forget"] | false)
+  {
+    if (g_sensors[si].present)
+    {
+      server.send(409, "application/json", "{\"ok\":false,\"err\":\"present\"}");
+      return;
+    }
+    // The zone must be re-pointed first: a control zone would lose its sensor, and a mask left
+    // empty would mean "every present sensor"
+    for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    {
+      const Zone &z = g_zones[i];
+      if (!z.used)
+        continue;
+      const bool uses = z.sensorAgg == ZA_CONTROL ? memcmp(z.sensorRom, g_sensors[si].rom, 8) == 0
+                                                  : z.sensorMask == (uint8_t)(1u << si);
+      if (uses)
+      {
+        char body[48];
+        snprintf(body, sizeof(body), "{\"ok\":false,\"err\":\"zone\",\"zone\":%u}", i);
+        server.send(409, "application/json", body);
+        return;
+      }
+    }
+    for (uint8_t i = (uint8_t)si; i + 1 < g_sensorCount; ++i)
+      g_sensors[i] = g_sensors[i + 1];
+    g_sensorCount--;
+    const uint8_t low = (uint8_t)((1u << si) - 1); // bits below the removed index stay put
+    bool zonesChanged = false;
+    for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    {
+      uint8_t m = g_zones[i].sensorMask;
+      uint8_t nm = (uint8_t)((m & low) | ((m >> 1) & ~low));
+      zonesChanged |= nm != m;
+      g_zones[i].sensorMask = nm;
+    }
+    if (zonesChanged)
+      saveZones();
+  }
+  else if (!in["label"].isNull())
+    strlcpy(g_sensors[si].label, in["label"] | "", sizeof(g_sensors[si].label));
+
+  bool ok = saveSensors();
+  server.send(ok ? 200 : 500, "application/json", ok ? "{\"ok\":true}" : "{\"ok\":false}");
+}
+
+// Controller selection + TPI tuning; POST with any subset of the GET fields
+static void controlToJson(JsonDocument &doc)
+{
+  doc["mode"] = ctlModeName(g_ctlMode);
+  doc["cycleS"] = g_tpiCfg.cycleMs / 1000;
+  doc["kp"] = g_tpiCfg.kpPmPerC / 10; // % duty per °C
+  doc["tiS"] = g_tpiCfg.tiMs / 1000;
+  doc["minPulseS"] = g_tpiCfg.minPulseMs / 1000;
+  doc["minOnS"] = g_heaterCfg.minOnMs / 1000;
+  doc["minOffS"] = g_heaterCfg.minOffMs / 1000;
+  doc["maxOnS"] = g_heaterCfg.maxOnMs / 1000;
+  doc["cooldownS"] = g_heaterCfg.cooldownMs / 1000;
+  jsonTemp(doc["reportDelta"], g_reportCfg.deltaCd);
+  doc["heartbeatS"] = g_reportCfg.heartbeatMs / 1000;
+  doc["pullS"] = g_reportCfg.pullMs / 1000;
+}
+
+void handleGetControl()
+{
+  JsonDocument doc;
+  controlToJson(doc);
+  String out;
+  serializeJson(doc, out);
+  server.send(200, "application/json", out);
+}
+
+void handlePostControl()
+{
+  if (!server.hasArg("plain"))
+  {
+    server.send(400, "text/plain", "Missing body");
+    return;
+  }
+  JsonDocument in;
+  DeserializationError e = deserializeJson(in, server.arg("plain"));
+  if (e)
+  {
+    server.send(400, "text/plain", String("JSON error: ") + e.c_str());
+    return;
+  }
+  uint8_t mode = g_ctlMode;
+  TpiConfig cfg = g_tpiCfg;
+  HeaterConfig hc = g_heaterCfg;
+  ReportConfig rc = g_reportCfg;
+  const uint16_t bad = controlFromJson(in.as<JsonVariantConst>(), mode, cfg, hc, rc);
+  if (bad)
+  {
+    const char *err = (bad & CF_MODE) ? "mode" : (bad == CF_PULSE ? "pulse" : "range");
+    char body[40];
+    snprintf(body, sizeof(body), "{\"ok\":false,\"err\":\"%s\"}", err);
+    server.send(422, "application/json", body);
+    return;
+  }
+  const TpiConfig run = tpi_effective(cfg, hc.minOnMs, hc.minOffMs);
+  const TpiConfig was = tpiRunConfig();
+  if (mode != g_ctlMode || memcmp(&run, &was, sizeof(run)) != 0)
+    for (uint8_t i = 0; i < MAX_ZONES; ++i)
+      g_zones[i].tpi.reset(); // start a fresh cycle with the new tuning
+  g_ctlMode = mode;
+  g_tpiCfg = cfg;
+  g_heaterCfg = hc; // running dwells are judged against the new times from the next tick
+  g_reportCfg = rc;
+  bool ok = saveControl();
+  JsonDocument out;
+  out["ok"] = ok;
+  controlToJson(out);
+  String body;
+  serializeJson(out, body);
+  server.send(ok ? 200 : 500, "application/json", body);
+}
+
+// 1-Wire bus inventory (debug): served from the sensor table kept current by ds_poll() and the
+// hot-plug scanner; no bus traffic in the handler
+void handleOwBus()
+{
+  const uint32_t now = millis();
+  JsonDocument doc;
+  JsonArray arr = doc["devices"].to<JsonArray>(); // present ROMs (pre-table format)
+  JsonArray det = doc["sensors"].to<JsonArray>();
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+  {
+    const DsSensor &sn = g_sensors[i];
+    char rom[24];
+    formatRom(sn.rom, rom);
+    if (sn.present)
+      arr.add(rom);
+    JsonObject o = det.add<JsonObject>();
+    o["rom"] = rom;
+    o["label"] = sn.label;
+    o["present"] = sn.present;
+    jsonTemp(o["temp"], sn.temp);
+    jsonTemp(o["raw"], sn.rawTemp);
+    if (cdeg_valid(sn.rawTemp))
+      o["ageMs"] = now - sn.readMs;
+    o["resolution"] = sn.resolution ? sn.resolution : g_ds.resolution();
+    o["crcErrors"] = sn.crcErrors;
+    o["readErrors"] = sn.readErrors;
+    if (DS_ALARM_MODE && sn.alarmSet)
+    {
+      o["alarmTh"] = sn.alarmTh;
+      o["alarmTl"] = sn.alarmTl;
+    }
+  }
+  doc["parasite"] = g_ds.parasite();
+  doc["resolution"] = g_ds.resolution();
+  doc["scanAgeMs"] = g_hpScans ? now - g_hpLastScanMs : now;
   String out;
   serializeJson(doc, out);
   server.send(200, "application/json", out);
@@ -1179,211 +3327,525 @@ static void setupOTA()
   Serial.printf("[OTA] Ready: %s.local:8266 (auth:%s)\n", HOSTNAME, (OTA_PASS && OTA_PASS[0] ? "yes" : "no"));
 }
 
-// ===== Control helper =====
-static float getActiveSetpoint() { return g_fixedEnabled ? g_fixedSetpoint : 19.0f; }
-
 // ======== DS18B20 Robust Bring-Up (BEFORE Wi-Fi) ========
-static uint8_t rom[8];
-static bool onewire_find_any()
+// Full bus search: marks known ROMs present, appends new DS18B20s to the table.
+// Returns how many sensors answered.
+static uint8_t ds_scan_bus()
 {
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
+    g_sensors[i].present = false;
+  uint8_t a[8];
+  uint8_t found = 0;
+  bool added = false;
   oneWire.reset_search();
-  if (!oneWire.search(rom))
-    return false;
-  return OneWire::crc8(rom, 7) == rom[7];
+  while (oneWire.search(a))
+  {
+    if (crc8_maxim(a, 7) != a[7] || a[0] != 0x28) // DS18B20 family only
+      continue;
+    found++;
+    int8_t si = sensorByRom(a);
+    if (si < 0)
+    {
+      if (g_sensorCount >= MAX_SENSORS)
+      {
+        Serial.println("[DS18B20] Sensor table full, ignoring new ROM");
+        continue;
+      }
+      si = (int8_t)g_sensorCount++;
+      g_sensors[si] = DsSensor();
+      memcpy(g_sensors[si].rom, a, 8);
+      g_sensors[si].temp = g_sensors[si].rawTemp = CDEG_INVALID;
+      added = true;
+    }
+    g_sensors[si].present = true;
+    g_sensors[si].misses = 0;
+  }
+  if (added)
+    saveSensors();
+  return found;
 }
 
-static uint16_t ds_tconv_ms()
+static void ds_mark_lost(DsSensor &sn)
 {
-  // 9/10/11/12-bit => ~94/188/375/750 ms
-  uint8_t res = g_haveAddress ? sensors.getResolution(g_dsAddr) : sensors.getResolution();
-  switch (res)
+  if (!sn.present)
+    return;
+  sn.present = false;
+  g_dsLost++;
+  char rom[24];
+  formatRom(sn.rom, rom);
+  Serial.printf("[DS18B20] Sensor %s %s disappeared\n", rom, sn.label);
+  g_hpBackoffMs = HP_BACKOFF_MIN_MS; // look for it again soon
+  g_hpNextMs = millis();
+  if (!ds_present_count())
   {
-  case 9:
-    return 94;
-  case 10:
-    return 188;
-  case 11:
-    return 375;
-  default:
-    return 750;
+    g_haveSensor = false;
+    g_dsPending = false;
   }
 }
 
+// Runs only while the bus is idle (no conversion in flight).
+static void ds_scan_tick(uint32_t now)
+{
+  uint32_t dt = now - g_hpRefillMs;
+  g_hpRefillMs = now;
+  if (dt > 10000)
+    dt = 10000;
+  g_hpTokensUs += (int32_t)(dt * HP_BUDGET_US_PER_MS);
+  if (g_hpTokensUs > HP_BUDGET_CAP_US)
+    g_hpTokensUs = HP_BUDGET_CAP_US;
+
+  if ((int32_t)(now - g_hpNextMs) < 0)
+    return;
+  if (g_hpTokensUs < (int32_t)g_hpLastCostUs)
+  {
+    g_hpBudgetSkips++;
+    return;
+  }
+
+  const uint8_t before = ds_present_count();
+  const uint32_t t0 = micros();
+  const uint8_t found = ds_scan_bus();
+  const uint32_t cost = micros() - t0;
+  g_hpLastCostUs = cost;
+  g_hpTokensUs -= (int32_t)cost;
+  g_hpUsTotal += cost;
+  g_hpScans++;
+  g_hpLastScanMs = now;
+
+  if (found > before)
+  {
+    g_dsAppeared += found - before;
+    g_ds.begin();
+    g_ds.setResolution(g_ds.resolution()); // new sensor starts from its EEPROM config
+    Serial.printf("[DS18B20] %u sensor(s) appeared (%u present, search %lu us)\n", found - before, found,
+                  (unsigned long)cost);
+  }
+  else if (found < before)
+  {
+    g_dsLost += before - found;
+    Serial.printf("[DS18B20] %u sensor(s) missing from search\n", before - found);
+  }
+  g_haveSensor = found > 0;
+  if (!g_haveSensor)
+    g_dsPending = false;
+
+  const bool missing = !found || found < g_sensorCount;
+  if (found != before)
+    g_hpBackoffMs = HP_BACKOFF_MIN_MS;
+  else if (missing && g_hpBackoffMs < HP_BACKOFF_MAX_MS)
+    g_hpBackoffMs = g_hpBackoffMs * 2 > HP_BACKOFF_MAX_MS ? HP_BACKOFF_MAX_MS : g_hpBackoffMs * 2;
+  g_hpNextMs = now + (missing ? g_hpBackoffMs : HP_DISCOVER_MS);
+}
+
+static uint16_t ds_tconv_ms() { return g_ds.conversionMs(); } // cached, no bus traffic
+
 static void ds_init_bus_and_probe_pre_wifi()
 {
   pinMode(ONE_WIRE_BUS, INPUT_PULLUP);
   delay(200);
-  sensors.begin();
-  sensors.setWaitForConversion(false); // <<< async conversions
-  sensors.setResolution(12);           // (optional: 10 for faster)
-  sensors.requestTemperatures();
+  g_ds.begin();           // parasite-power check
+  g_ds.setResolution(12); // Skip ROM: every sensor, resolution cached in the driver
+  g_ds.convertAll();
   delay(10);
-  bool found = onewire_find_any();
+  uint8_t found = ds_scan_bus();
   if (!found)
   {
-    Serial.println("[DS18B20] Raw search: no devices yet, retrying...");
+    Serial.println("[DS18B20] Bus search: no devices yet, retrying...");
     delay(200);
-    found = onewire_find_any();
+    found = ds_scan_bus();
   }
-  uint8_t count = sensors.getDeviceCount();
-  Serial.printf("[DS18B20] Dallas count: %u  RawFound:%s\n", count, found ? "YES" : "NO");
-  g_haveSensor = found || (count > 0);
+  g_haveSensor = found > 0;
   if (g_haveSensor)
   {
-    g_haveAddress = sensors.getAddress(g_dsAddr, 0);
-    if (g_haveAddress)
+    Serial.printf("[DS18B20] %u sensor(s) on D4:\n", found);
+    for (uint8_t i = 0; i < g_sensorCount; ++i)
     {
-      Serial.print("[DS18B20] Sensor[0] address: ");
-      for (uint8_t i = 0; i < 8; i++)
-        Serial.printf("%02X%s", g_dsAddr[i], (i < 7 ? ":" : ""));
-      Serial.println();
-      sensors.setResolution(g_dsAddr, 12);
-    }
-    else
-    {
-      Serial.println("[DS18B20] Using by-index mode until address resolves.");
+      if (!g_sensors[i].present)
+        continue;
+      char rom[24];
+      formatRom(g_sensors[i].rom, rom);
+      Serial.printf("[DS18B20]   [%u] %s %s\n", i, rom, g_sensors[i].label);
     }
   }
   else
   {
     Serial.println("[DS18B20] No sensor found on D4. Will keep scanning in loop().");
   }
+  g_hpRefillMs = millis();
+  g_hpNextMs = g_hpRefillMs + (found && found == g_sensorCount ? HP_DISCOVER_MS : HP_BACKOFF_MIN_MS);
 }
 
-static bool ds_try_hotplug()
+static bool ds_valid(cdeg_t t) { return cdeg_valid(t) && t >= -5500 && t <= 12500; }
+
+// Bus-wide resolution from the zone closest to one of its switching thresholds
+static void ds_adapt_resolution()
 {
-  sensors.requestTemperatures();
-  delay(5);
-  if (onewire_find_any())
+  const cdeg_t half = HYST_BAND_CD / 2;
+  int16_t dist = -1; // none yet
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
   {
-    g_haveSensor = true;
-    g_haveAddress = sensors.getAddress(g_dsAddr, 0);
-    if (g_haveAddress)
-      sensors.setResolution(g_dsAddr, 12);
-    Serial.println(g_haveAddress ? "[DS18B20] Sensor appeared — address mode." : "[DS18B20] Sensor appeared — index mode.");
-    return true;
+    const Zone &z = g_zones[i];
+    if (!z.used)
+      continue;
+    if (!cdeg_valid(z.temp))
+      return; // keep current resolution until every zone has a reading
+    const cdeg_t sp = zoneSetpoint(i);
+    const cdeg_t th[3] = {(cdeg_t)(sp - half), (cdeg_t)(sp + half), HEAT_CUTOFF_CD};
+    for (cdeg_t x : th)
+    {
+      int16_t d = (int16_t)abs(z.temp - x);
+      if (dist < 0 || d < dist)
+        dist = d;
+    }
+  }
+  uint8_t want = ds_pick_resolution(dist, g_ds.resolution());
+  if (want == g_ds.resolution())
+    return;
+  if (g_ds.setResolution(want))
+  {
+    g_dsResChanges++;
+    Serial.printf("[DS18B20] Resolution -> %u bit (%d.%02d°C from threshold)\n", want, dist / 100, dist % 100);
   }
-  return false;
 }
 
-static bool ds_poll(float &outC)
+static void ds_count_sample(uint32_t now)
 {
-  if (!g_haveSensor)
-    return false;
-
-  if (!g_dsPending)
+  g_dsSamples++;
+  g_dsRateWinSamples++;
+  uint32_t win = now - g_dsRateWinStartMs;
+  if (win >= 10000)
   {
-    sensors.requestTemperatures(); // start conversion
-    g_dsReqAt = millis();
-    g_dsPending = true;
-    return false;
+    g_dsRateHz = g_dsRateWinSamples * 1000.0f / win;
+    g_dsRateWinSamples = 0;
+    g_dsRateWinStartMs = now;
   }
-  if ((uint32_t)(millis() - g_dsReqAt) < ds_tconv_ms())
-    return false; // still converting (non-blocking)
+}
 
-  // ready to read without starting a new conversion
-  float t = g_haveAddress ? sensors.getTempC(g_dsAddr) : sensors.getTempCByIndex(0);
-  g_dsPending = false; // allow next kick
-  if (t == DEVICE_DISCONNECTED_C || t < -55 || t > 125)
+// One Skip-ROM conversion for the whole bus (N sensors, one tCONV window), then one
+// scratchpad read per present sensor. Returns true when at least one sensor got a fresh reading.
+static bool ds_kick(uint32_t now)
+{
+  if (!g_ds.convertAll()) // Skip ROM, whole bus
+  {
+    g_dsKickRetryAt = now + 200;
+    if (++g_dsKickFails >= DS_MISS_LIMIT) // nobody answers the reset pulse: bus is empty
+      for (uint8_t i = 0; i < g_sensorCount; ++i)
+        ds_mark_lost(g_sensors[i]);
     return false;
-  outC = t;
+  }
+  g_dsKickFails = 0;
+  g_dsReqAt = now;
+  g_dsPending = true;
   return true;
 }
 
-// ===================== SETUP =====================
-void setup()
+// Alarm mode: per sensor, the earliest-firing TH/TL over every zone it feeds
+static void ds_program_alarms()
 {
-  Serial.begin(115200);
-  delay(200);
-  if (!LittleFS.begin())
+  const cdeg_t half = HYST_BAND_CD / 2;
+  for (uint8_t si = 0; si < g_sensorCount; ++si)
   {
-    Serial.println("[FS] LittleFS mount failed, formatting...");
-    LittleFS.format();
-    LittleFS.begin();
+    DsSensor &sn = g_sensors[si];
+    if (!sn.present)
+      continue;
+    int8_t th = 125, tl = -55;
+    for (uint8_t zi = 0; zi < MAX_ZONES; ++zi)
+    {
+      const Zone &z = g_zones[zi];
+      if (!z.used)
+        continue;
+      bool feeds;
+      if (z.sensorAgg == ZA_CONTROL)
+        feeds = zoneRomIsPrimary(z) ? sensorPrimary() == (int8_t)si : memcmp(z.sensorRom, sn.rom, 8) == 0;
+      else
+        feeds = !z.sensorMask || (z.sensorMask & (1u << si));
+      if (!feeds)
+        continue;
+      const cdeg_t sp = zoneSetpoint(zi);
+      cdeg_t offTh = (cdeg_t)(sp + half);
+      if (offTh > HEAT_CUTOFF_CD)
+        offTh = HEAT_CUTOFF_CD;
+      int8_t zth, ztl;
+      ds_alarm_thresholds((int16_t)(sp - half), offTh, z.action == 1, zth, ztl);
+      if (zth < th)
+        th = zth;
+      if (ztl > tl)
+        tl = ztl;
+    }
+    if (sn.alarmSet && sn.alarmGen == g_ds.configGen() && sn.alarmTh == th && sn.alarmTl == tl)
+      continue;
+    if (g_ds.writeAlarm(sn.rom, th, tl))
+    {
+      sn.alarmTh = th;
+      sn.alarmTl = tl;
+      sn.alarmSet = true;
+      sn.alarmGen = g_ds.configGen();
+    }
   }
-  loadFixedSetpoint();
-  g_lastSavedSetpoint = g_fixedSetpoint;
-  loadWifiCreds();
-  initLegacySchedule();
-  ds_init_bus_and_probe_pre_wifi();
+}
 
-  connectWiFi();
-  setupTimeNTP();
-  setupMDNS();
-  setupOTA(); // enable OTA when Wi-Fi is ready
+static bool ds_poll()
+{
+  if (!g_haveSensor)
+    return false;
 
-  // Web routes
-  server.on("/", HTTP_GET, handleIndex);
-  server.on("/wifi", HTTP_GET, handleWifiPage);
-  server.on("/api/fixed", HTTP_GET, handleGetFixed);
-  server.on("/api/fixed", HTTP_POST, handlePostFixed);
-  server.on("/api/time", HTTP_GET, handleTime);
-  server.on("/api/status", HTTP_GET, handleStatus);
-  server.on("/api/owbus", HTTP_GET, handleOwBus);
-  server.on("/api/wifi/scan", HTTP_GET, handleWifiScan);
-  server.on("/api/wifi/current", HTTP_GET, handleWifiCurrent);
-  server.on("/api/wifi/save", HTTP_POST, handleWifiSave);
-  server.begin();
-  Serial.println("[WEB] HTTP server started on port 80");
+  uint32_t now = millis();
+  if (!g_dsPending)
+  {
+    if (DS_ALARM_MODE && g_dsReqAt && now - g_dsReqAt < DS_ALARM_CONVERT_MS)
+      return false; // alarm mode: idle between conversions
+    if ((int32_t)(now - g_dsKickRetryAt) >= 0)
+      ds_kick(now);
+    return false;
+  }
+  const uint16_t tconv = ds_tconv_ms();
+  if ((uint32_t)(now - g_dsReqAt) < tconv)
+    return false; // still converting (non-blocking)
 
-  // ESPNOW on AP channel
-  int channel = WiFi.channel();
-  if (channel <= 0)
+  // ready: one scratchpad read per present ROM, all stamped with the conversion end
+  g_dsPending = false;
+  const uint32_t sampleAt = g_dsReqAt + tconv;
+
+  // Alarm mode: read only sensors that answer Alarm Search, everything once a minute
+  bool fullRead = true;
+  uint8_t alarmMask = 0;
+  if (DS_ALARM_MODE)
   {
-    channel = 1;
-    Serial.println("[TX] Using fallback channel=1");
+    // TPI integrates the error continuously: alarm thresholds only serve the hysteresis
+    fullRead = g_ctlMode == CTL_TPI || !g_dsFullReadAt || now - g_dsFullReadAt >= DS_ALARM_FULL_READ_MS;
+    if (fullRead)
+      g_dsFullReadAt = now;
+    else
+      g_ds.alarmSearch([&](const uint8_t *rom)
+                       {
+        int8_t si = sensorByRom(rom);
+        if (si >= 0)
+          alarmMask |= (uint8_t)(1u << si); });
   }
-  wifi_set_channel(channel);
-  Serial.printf("[TX] Locked radio to channel %d\n", channel);
-  int rc = esp_now_init();
-  Serial.printf("[TX] esp_now_init -> %d\n", rc);
-  if (rc != 0)
+
+  bool any = false;
+  for (uint8_t i = 0; i < g_sensorCount; ++i)
   {
-    Serial.println("[TX] ESPNOW init failed; rebooting...");
-    delay(1500);
-    ESP.restart();
+    DsSensor &sn = g_sensors[i];
+    if (!sn.present || (!fullRead && !(alarmMask & (1u << i))))
+      continue;
+    int16_t raw = g_ds.readRaw(sn.rom);
+    if (raw == DS_RAW_INVALID)
+    {
+      if (g_ds.lastError() == DS_READ_CRC)
+        sn.crcErrors++;
+      else
+        sn.readErrors++;
+      if (++sn.misses >= DS_MISS_LIMIT)
+        ds_mark_lost(sn);
+      continue;
+    }
+    sn.misses = 0;
+    sn.resolution = g_ds.lastResolution();
+    cdeg_t t = cdeg_from_raw16(raw);
+    if (!ds_valid(t))
+      continue;
+    sn.rawTemp = t;
+    const uint32_t rej = sn.filter.rejected();
+    cdeg_t f = sn.filter.push(t, g_filterCfg);
+    if (sn.filter.rejected() != rej || !cdeg_valid(f))
+      continue; // spike dropped: zones keep the previous value
+    sn.temp = f;
+    sn.readMs = sampleAt;
+    any = true;
   }
-  esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
-  esp_now_register_send_cb(onDataSent);
-  esp_now_register_recv_cb(onDataRecv);
+  now = millis();
+  // Zones: control sensor or min/mean aggregate; a zone without fresh input keeps its last value
+  // until taskControl() drops it as stale
+  for (uint8_t i = 0; any && i < MAX_ZONES; ++i)
+  {
+    Zone &z = g_zones[i];
+    if (!z.used)
+      continue;
+    cdeg_t t = zoneSensorTemp(z, now);
+    if (cdeg_valid(t))
+    {
+      z.temp = t;
+      z.tempAtMs = sampleAt;
+    }
+  }
+  if (any)
+  {
+    if (g_dsSamples && !DS_ALARM_MODE) // alarm-mode reads are event-driven, no period
+    {
+      int32_t period = (int32_t)(sampleAt - g_dsSampleAtMs);
+      g_dsJitter.add((uint32_t)abs(period - (int32_t)tconv));
+    }
+    g_dsSampleAtMs = sampleAt;
+    ds_count_sample(now);
+    ds_adapt_resolution(); // takes effect with the conversion started below
+  }
+  ds_scan_tick(now); // bus idle between read and convert: the only safe slot for a search
+  if (DS_ALARM_MODE && g_haveSensor)
+    ds_program_alarms(); // follows setpoint / heating-state changes, no-op otherwise
+  else if (g_haveSensor)
+    ds_kick(now); // back-to-back: next conversion runs while the loop does the rest
+  return any;
+}
 
-  rc = esp_now_add_peer(TARGET, ESP_NOW_ROLE_COMBO, channel, NULL, 0);
-  Serial.print("[TX] add_peer(");
-  printMac(TARGET);
-  Serial.print(") -> ");
-  Serial.println(rc);
+// ===================== TASKS =====================
+// loop() is one pass of a fixed-table cooperative scheduler (coop_sched.h). The control tick
+// and the DS18B20 poll are most urgent, web/OTA next, HTTPS last: a slow TLS call or web
+// request delays the control tick by at most its own run time, never by the rest of the pass.
+static bool g_freshTemp = false; // ds task -> control task: a new sample is in
+
+static void taskDs();
+static void taskControl();
+static void taskEspnow();
+static void taskWeb();
+static void taskOta();
+static void taskWifi();
+static void taskSys();
+static void taskSleep();
+static void taskReport();
+
+enum TaskId : uint8_t
+{
+  TASK_DS = 0,
+  TASK_CTL,
+  TASK_ESPNOW,
+  TASK_WEB,
+  TASK_OTA,
+  TASK_WIFI,
+  TASK_SYS,
+  TASK_SLEEP,
+  TASK_REPORT,
+  TASK_COUNT,
+};
 
-  Serial.printf("[TX] STA MAC: %s\n", WiFi.macAddress().c_str());
-  Serial.printf("[TX] Ready. Open http://%s.local or http://%s\n", HOSTNAME, WiFi.localIP().toString().c_str());
+//                     name      fn           periodMs  prio deadlineMs
+static CoopTask g_taskTable[TASK_COUNT] = {
+    {"ds", taskDs, 10, 0, 50},
+    {"control", taskControl, 200, 0, 100}, // ~5 Hz, or right after a new sample
+    {"espnow", taskEspnow, 5, 1, 50},
+    {"web", taskWeb, 0, 2, 250},
+    {"ota", taskOta, 20, 2, 250},
+    {"wifi", taskWifi, 100, 3, 500},
+    {"sys", taskSys, 100, 3, 1000},
+    {"sleep", taskSleep, 1000, 3, 1000},
+    {"report", taskReport, HTTP_MIN_INTERVAL_MS, 4, 2500}, // HTTPS: up to ~800 ms per call
+};
+static CoopScheduler g_loopSched(
+    g_taskTable, TASK_COUNT, []() -> uint32_t { return millis(); }, []() -> uint32_t { return micros(); });
+
+// Non-blocking DS18B20 poll (all zones), often enough that short 9/10-bit conversions are read
+// as soon as they are ready; a fresh sample releases the control task right away
+static void taskDs()
+{
+  if (g_haveSensor && ds_poll())
+  {
+    g_freshTemp = true;
+    g_loopSched.kick(TASK_CTL);
+  }
 }
 
-// ===================== LOOP =====================
-// --- Strict 0.5 °C hysteresis (±0.25 °C): ON when temp < sp-0.25, OFF when temp > sp+0.25
-static inline uint8_t apply_hysteresis(float temp, float sp, uint8_t prev)
+static void taskControl()
 {
-  const float half = HYST_BAND_C * 0.5f; // 0.25
-  const float on_th = sp - half;         // below => ON
-  const float off_th = sp + half;        // above => OFF
-  if (temp >= 19.8)
-    return 0;
-  if (temp < on_th)
-    return 1; // strictly less
-  if (temp > off_th)
-    return 0; // strictly greater
+  const bool freshTemp = g_freshTemp;
+  g_freshTemp = false;
+
+  // Hot-plug scan while the bus is empty (backoff + bus-time budget inside)
+  if (!g_haveSensor)
+    ds_scan_tick(millis());
+
+  // Rate learner: one O(1) update per fresh sample, under the relay state it was taken with
+  if (freshTemp)
+    for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    {
+      Zone &z = g_zones[i];
+      if (!z.used)
+        continue;
+      z.learn.push(z.temp, z.haveAck ? z.ackRelayOn : z.heaterOn, z.tempAtMs);
+      if (z.learn.takeDirty())
+        g_heatRateDirty = true;
+    }
+  scheduleTick();
+  preheatTick(millis());
+
+  // Per zone: controller (strict hysteresis or TPI) -> heater output -> change/heartbeat command
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+  {
+    Zone &z = g_zones[i];
+    if (!z.used)
+      continue;
+
+    // A reading DS_STALE_MS old (sensor lost, bus silent) is dropped: fail-safe OFF below
+    const cdeg_t fresh = temp_if_fresh(z.temp, z.tempAtMs, millis(), DS_STALE_MS);
+    if (fresh != z.temp)
+    {
+      z.temp = fresh;
+      Serial.printf("[SAFETY] Zone %u reading stale, heater forced OFF\n", i);
+    }
+
+    // Decide action with the selected controller if we have any valid temperature
+    if (cdeg_valid(z.temp))
+    {
+      g_dsAgeAtDecision.add(millis() - z.tempAtMs);
+      if (g_ctlMode == CTL_TPI)
+      {
+        bool on = z.tpi.update(z.temp, zoneSetpoint(i), millis(), tpiRunConfig());
+        z.action = (on && z.temp < HEAT_CUTOFF_CD) ? 1 : 0; // same hard cutoff as the hysteresis
+      }
+      else
+        z.action = apply_hysteresis(z.temp, zoneSetpoint(i), z.action);
+    }
+    else
+      z.action = 0; // sensor invalid -> safe OFF
+
+    const bool prevOn = z.heaterOn;
+
+    // --- Heater output (heat_control.h): min ON/OFF, max ON -> cooldown, wrap-safe timers ---
+    // Fail-safe OFF skips the minimum ON time: no reading, hard cutoff, or link judged down
+    // (OFF until ACKs come back)
+    const bool failSafe = !cdeg_valid(z.temp) || z.temp >= HEAT_CUTOFF_CD || z.link.down();
+    z.heaterOn = z.out.update(z.action == 1, failSafe, millis(), g_heaterCfg);
+    if (z.out.event() == HE_COOLDOWN)
+      Serial.printf("[SAFETY] Zone %u heater forced OFF for %lu minutes\n", i,
+                    (unsigned long)(g_heaterCfg.cooldownMs / 60000));
+    else if (z.out.event() == HE_RELEASED)
+      Serial.printf("[SAFETY] Zone %u forced OFF period ended, normal control resumed\n", i);
+
+    // === ESP-NOW TX to relay: sends on change, ARQ retry or heartbeat ===
+    cmdSchedulerTick(z, z.heaterOn != prevOn);
+  }
+}
 
-  return prev; // inside band -> hold
+// Decode queued ESP-NOW frames; a relay learned from an ACK -> unicast peer + persist
+static void taskEspnow()
+{
+  espnowDrainRx();
+  relayPairingTick();
+  channelTick(); // follow radio channel changes, sweep when the relay went silent
 }
 
-void loop()
+// Service web server aggressively for snappy UI
+static void taskWeb()
 {
-  // Service web server aggressively for snappy UI
   for (uint8_t i = 0; i < 3; ++i)
   {
     server.handleClient();
     yield();
   }
+}
+
+// OTA & mDNS only when STA is up
+static void taskOta()
+{
+  if (WiFi.status() == WL_CONNECTED)
+  {
+    MDNS.update();
+    ArduinoOTA.handle();
+  }
+}
 
-  // ===== Connectivity management (AP fallback + 2-minute STA retries) =====
+// ===== Connectivity management (AP fallback + 2-minute STA retries) =====
+static void taskWifi()
+{
   static bool prevSta = false;
   static uint32_t lastStaRetryMs = 0;
 
@@ -1419,165 +3881,194 @@ void loop()
       WiFi.begin(g_wifiSsid.c_str(), g_wifiPass.c_str()); // async; no blocking wait
     }
   }
-
-  // OTA & mDNS only when STA is up
-  if (sta)
-  {
-    MDNS.update();
-    ArduinoOTA.handle();
-  }
   prevSta = sta;
+}
 
-  // Handle deferred reboot after saving Wi-Fi
+// Deferred reboot after saving Wi-Fi, rate-limited flash writes
+static void taskSys()
+{
   if (g_pendingRestart && (int32_t)(millis() - g_restartAtMs) >= 0)
   {
     Serial.println("[SYS] Rebooting to apply new Wi-Fi credentials...");
     delay(100);
     ESP.restart();
   }
+  if (g_heatRateDirty && millis() - g_heatRateSavedMs >= HEATRATE_SAVE_MIN_MS)
+  {
+    g_heatRateDirty = false;
+    g_heatRateSavedMs = millis();
+    saveHeatRates();
+  }
+}
 
-  // ===== Sensor / Control / Reporting (non-blocking cadence) =====
-  static uint32_t tCtl = 0;
-  if (millis() - tCtl > 200)
-  { // ~5 Hz
-    tCtl = millis();
-
-    // Hot-plug check
-    if (!g_haveSensor)
-    {
-      (void)ds_try_hotplug();
-    }
-
-    // Non-blocking DS18B20 poll
-    float freshC;
-    bool gotFresh = ds_poll(freshC);
-    if (gotFresh)
-      g_lastTempC = freshC; // - 3.0f;
-
-    // Decide action with strict hysteresis if we have any valid temperature
-    const bool haveTemp = isfinite(g_lastTempC);
-    float sp = getActiveSetpoint();
-    uint8_t action = g_lastAction;
+// ===== Power-saving mode based on setpoint =====
+static void taskSleep()
+{
+  cdeg_t spNow = zoneSetpoint(0); // a running optimal start keeps the device awake
 
-    if (haveTemp)
+  if (spNow <= 1000)
+  {
+    // enter / stay in sleep mode
+    if (!sleepModeActive)
     {
-      action = apply_hysteresis(g_lastTempC, sp, g_lastAction);
+      sleepModeActive = true;
+      sleepWaitingRemote = true; // on this wake, wait for a good remote reply
+      g_report.force();          // ...and ask for it now, not at the next heartbeat
+      Serial.println("[SLEEP] Low setpoint -> wait for remote, then sleep 10 minutes");
     }
-    else
+  }
+  else
+  {
+    // leave sleep mode
+    if (sleepModeActive)
     {
-      action = 0; // sensor invalid -> safe OFF
+      Serial.println("[SLEEP] Setpoint > 10 -> staying active");
     }
-    g_lastAction = action;
-
-    // === ESP-NOW TX to relay: {"heater":"ON"/"OFF"} ===
-    static long timerAction = millis();
+    sleepModeActive = false;
+    sleepWaitingRemote = false;
+  }
+}
 
-    {
-      static String azione = "OFF";
-      static uint32_t onStartMs = 0;
-      static bool forcedOff = false;
-      static uint32_t forcedOffUntil = 0;
-
-      if (millis() - timerAction > 60000)
-      { // update every minute
-        // --- Safety logic: auto OFF after 1 hour ON, cool down 30 minutes ---
-        if (azione == "ON")
-        {
-          if (onStartMs == 0)
-            onStartMs = millis(); // mark when ON started
-          if (!forcedOff && millis() - onStartMs >= 3600000UL)
-          { // 1 hour
-            forcedOff = true;
-            forcedOffUntil = millis() + 1800000UL; // 30 minutes OFF
-            Serial.println("[SAFETY] Heater forced OFF for 30 minutes");
-          }
-        }
-        else
-        {
-          onStartMs = 0; // reset ON timer when OFF
-        }
-
-        // If currently under forced OFF period
-        if (forcedOff)
-        {
-          if (millis() >= forcedOffUntil)
-          {
-            forcedOff = false;
-            Serial.println("[SAFETY] Forced OFF period ended, normal control resumed");
-          }
-          else
-          {
-            azione = "OFF"; // keep OFF during safety period
-          }
-        }
-        else
-        {
-          azione = (action == 1) ? "ON" : "OFF";
-        }
-
-        timerAction = millis();
-      }
+// === HTTPS report, main zone, use ACK if available ===
+// Checked every 1.5 s; sends only on a change, a heartbeat or a setpoint pull (report_policy.h)
+static void taskReport()
+{
+  if (WiFi.status() != WL_CONNECTED || g_apActive)
+    return;
+  const Zone &z0 = g_zones[0];
+  bool heatingForReport = z0.haveAck ? z0.ackRelayOn : (z0.action == 1);
+  const uint8_t why = g_report.due(g_reportCfg, z0.temp, heatingForReport, millis());
+  if (why == RR_NONE)
+    return;
+  Serial.printf("[HTTP] %s (%s)\n", why == RR_PULL ? "Pull" : "Report", report_reason_name(why));
+  bool ok = cesanaReportAndFetch(why != RR_PULL, z0.temp, heatingForReport); // <- capture result
+  g_lastHttpMs = millis();
+  g_report.done(why, ok, z0.temp, heatingForReport, g_lastHttpMs);
+  if (ok)
+    scheduleSyncTick(); // pull the program only when its version changed
 
-      JsonDocument jtx;
-      jtx["heater"] = azione;
-      jtx["id"] = 12; // indirizzo della caldaia
-      char buf[32];
-      size_t n = serializeJson(jtx, buf, sizeof(buf));
-      int rc = esp_now_send(TARGET, (uint8_t *)buf, (int)n);
-      Serial.print("[TX] send -> ");
-      Serial.println(rc == 0 ? "OK" : String(rc));
-    }
+  // If we're in sleep mode and we were waiting for the remote -> we can sleep now
+  if (sleepModeActive && sleepWaitingRemote && ok)
+  {
+    Serial.println("[SLEEP] Remote answered OK, going to deep sleep for 10 minutes...");
+    ESP.deepSleep(1ULL * 60ULL * 1000000ULL); // 1 minutes
+    delay(100);
+  }
+}
 
-    // === HTTPS report every 1.5s (min), use ACK if available ===
-    if (haveTemp && (millis() - g_lastHttpMs >= HTTP_MIN_INTERVAL_MS))
-    {
-      bool heatingForReport = g_haveAck ? g_ackRelayOn : (action == 1);
-      bool ok = cesanaReportAndFetch(g_lastTempC, heatingForReport); // <- capture result
-      g_lastHttpMs = millis();
+// Scheduler stats: per task run time (us), lateness (ms), deadline misses, skipped releases
+void handleTasks()
+{
+  JsonDocument doc;
+  doc["passes"] = g_loopSched.passes();
+  doc["maxPassUs"] = g_loopSched.maxPassUs();
+  JsonArray arr = doc["tasks"].to<JsonArray>();
+  for (uint8_t i = 0; i < g_loopSched.count(); ++i)
+  {
+    const CoopTask &t = g_loopSched.task(i);
+    JsonObject o = arr.add<JsonObject>();
+    o["name"] = t.name;
+    o["periodMs"] = t.periodMs;
+    o["priority"] = t.priority;
+    o["deadlineMs"] = t.deadlineMs;
+    o["runs"] = t.runs;
+    o["lastUs"] = t.lastUs;
+    o["maxUs"] = t.maxUs;
+    o["avgUs"] = t.runs ? (uint32_t)(t.totalUs / t.runs) : 0;
+    o["maxLateMs"] = t.maxLateMs;
+    o["avgLateMs"] = t.runs ? (uint32_t)(t.totalLateMs / t.runs) : 0;
+    o["overruns"] = t.overruns;
+    o["skipped"] = t.skipped;
+  }
+  String out;
+  serializeJson(doc, out);
+  server.send(200, "application/json", out);
+}
 
-      // If we're in sleep mode and we were waiting for the remote -> we can sleep now
-      if (sleepModeActive && sleepWaitingRemote && ok)
-      {
-        Serial.println("[SLEEP] Remote answered OK, going to deep sleep for 10 minutes...");
-        ESP.deepSleep(1ULL * 60ULL * 1000000ULL); // 1 minutes
-        delay(100);
-      }
-    }
+// ===================== SETUP =====================
+void setup()
+{
+  Serial.begin(115200);
+  delay(200);
+  if (!LittleFS.begin())
+  {
+    Serial.println("[FS] LittleFS mount failed, formatting...");
+    LittleFS.format();
+    LittleFS.begin();
+  }
+  loadFixedSetpoint();
+  g_lastSavedSetpoint = g_fixedSetpoint;
+  loadWifiCreds();
+  loadZones();
+  loadSensors();
+  loadControl();
+  loadHeatRates();
+  loadSchedule();
+  ds_init_bus_and_probe_pre_wifi();
 
-    // Keep doing AP-availability check (cheap; pairs well with 2-min retry)
-    static uint32_t lastApChk = 0;
-    if (millis() - lastApChk > 2000)
-    {
-      lastApChk = millis();
-      if (!sta && !g_apActive)
-      {
-        Serial.println("[WiFi] STA down & AP not active -> starting AP fallback (periodic check)");
-        startApFallback();
-      }
-    }
+  connectWiFi();
+  setupTimeNTP();
+  setupMDNS();
+  setupOTA(); // enable OTA when Wi-Fi is ready
 
-    // ===== Power-saving mode based on setpoint =====
-    float spNow = getActiveSetpoint();
+  // Web routes
+  server.on("/", HTTP_GET, handleIndex);
+  server.on("/wifi", HTTP_GET, handleWifiPage);
+  server.on("/api/fixed", HTTP_GET, handleGetFixed);
+  server.on("/api/fixed", HTTP_POST, handlePostFixed);
+  server.on("/api/time", HTTP_GET, handleTime);
+  server.on("/api/status", HTTP_GET, handleStatus);
+  server.on("/api/owbus", HTTP_GET, handleOwBus);
+  server.on("/api/wifi/scan", HTTP_GET, handleWifiScan);
+  server.on("/api/wifi/current", HTTP_GET, handleWifiCurrent);
+  server.on("/api/wifi/save", HTTP_POST, handleWifiSave);
+  server.on("/api/zones", HTTP_GET, handleGetZones);
+  server.on("/api/zones", HTTP_POST, handlePostZones);
+  server.on("/api/sensors", HTTP_GET, handleGetSensors);
+  server.on("/api/sensors", HTTP_POST, handlePostSensors);
+  server.on("/api/control", HTTP_GET, handleGetControl);
+  server.on("/api/control", HTTP_POST, handlePostControl);
+  server.on("/api/tasks", HTTP_GET, handleTasks);
+  server.on("/api/espnow/stats", HTTP_GET, handleEspnowStats);
+  server.on("/api/espnow/unpair", HTTP_POST, handleEspnowUnpair);
+  server.begin();
+  Serial.println("[WEB] HTTP server started on port 80");
 
-    if (spNow <= 10.0f)
-    {
-      // enter / stay in sleep mode
-      if (!sleepModeActive)
-      {
-        sleepModeActive = true;
-        sleepWaitingRemote = true; // on this wake, wait for a good remote reply
-        Serial.println("[SLEEP] Low setpoint -> wait for remote, then sleep 10 minutes");
-      }
-    }
-    else
-    {
-      // leave sleep mode
-      if (sleepModeActive)
-      {
-        Serial.println("[SLEEP] Setpoint > 10 -> staying active");
-      }
-      sleepModeActive = false;
-      sleepWaitingRemote = false;
-    }
+  // ESPNOW on AP channel
+  int channel = WiFi.channel();
+  if (channel <= 0)
+  {
+    channel = 1;
+    Serial.println("[TX] Using fallback channel=1");
+  }
+  wifi_set_channel(channel);
+  g_espnowChannel = (uint8_t)channel;
+  Serial.printf("[TX] Locked radio to channel %d\n", channel);
+  int rc = esp_now_init();
+  Serial.printf("[TX] esp_now_init -> %d\n", rc);
+  if (rc != 0)
+  {
+    Serial.println("[TX] ESPNOW init failed; rebooting...");
+    delay(1500);
+    ESP.restart();
   }
+  esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
+  esp_now_register_send_cb(onDataSent);
+  esp_now_register_recv_cb(onDataRecv);
+
+  // Broadcast peer stays registered for discovery; paired relays go unicast
+  espnowAddPeer(BROADCAST_MAC);
+  for (uint8_t i = 0; i < MAX_ZONES; ++i)
+    if (g_zones[i].used && g_zones[i].paired)
+      espnowAddPeer(g_zones[i].relayMac);
+
+  Serial.printf("[TX] STA MAC: %s\n", WiFi.macAddress().c_str());
+  Serial.printf("[TX] Ready. Open http://%s.local or http://%s\n", HOSTNAME, WiFi.localIP().toString().c_str());
+  g_loopSched.begin(); // first releases now
+}
+
+// ===================== LOOP =====================
+void loop()
+{
+  g_loopSched.runPass();
 }
@@ -0,0 +1,145 @@
+// Host tests + per-tick benchmark for include/centideg.h (pio test -e native)
+// The float path below is the pre-cdeg_t tick: raw -> float °C, float hysteresis with the
+// 19.8 double-promoting cutoff, fabsf threshold distances, "%.1f" for the URL. A host CPU
+// has an FPU, so the ratio understates the soft-float cost on the LX106; it is a floor.
+
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "centideg.h"
+#include "heat_control.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_raw16_conversion_full_range()
+{
+  // DS18B20 range -55..125 °C in 1/16 steps: exact x6.25, rounded half away from zero
+  for (int32_t raw = -55 * 16; raw <= 125 * 16; ++raw)
+  {
+    const int32_t x4 = raw * 25; // 0.01 °C x4
+    const int32_t want = x4 >= 0 ? (x4 + 2) / 4 : -((-x4 + 2) / 4);
+    TEST_ASSERT_EQUAL(want, cdeg_from_raw16((int16_t)raw));
+  }
+  TEST_ASSERT_EQUAL(8500, cdeg_from_raw16(0x0550));        // 85 °C power-on value
+  TEST_ASSERT_EQUAL(-1013, cdeg_from_raw16((int16_t)0xFF5E)); // -10.125 -> -10.13
+}
+
+static void test_format()
+{
+  char b[8];
+  TEST_ASSERT_EQUAL(4, cdeg_format(1985, b, 1));
+  TEST_ASSERT_EQUAL_STRING("19.9", b);
+  cdeg_format(1984, b, 1);
+  TEST_ASSERT_EQUAL_STRING("19.8", b);
+  cdeg_format(-5, b, 1);
+  TEST_ASSERT_EQUAL_STRING("-0.1", b);
+  cdeg_format(-4, b, 1);
+  TEST_ASSERT_EQUAL_STRING("0.0", b); // no "-0.0"
+  cdeg_format(-5500, b, 2);
+  TEST_ASSERT_EQUAL_STRING("-55.00", b);
+  cdeg_format(12507, b, 2);
+  TEST_ASSERT_EQUAL_STRING("125.07", b);
+  // Every tenth round-trips through the same digits strtod reads back
+  for (int32_t v = -5500; v <= 12500; v += 10)
+  {
+    cdeg_format((cdeg_t)v, b, 1);
+    TEST_ASSERT_EQUAL(v, (int32_t)lround(strtod(b, nullptr) * 100));
+  }
+}
+
+static void test_from_c_boundary()
+{
+  TEST_ASSERT_EQUAL(1980, cdeg_from_c(19.8f));
+  TEST_ASSERT_EQUAL(-1, cdeg_from_c(-0.01f));
+  TEST_ASSERT_EQUAL(CDEG_INVALID, cdeg_from_c(NAN));
+  TEST_ASSERT_EQUAL(CDEG_INVALID, cdeg_from_c(400.0f));
+  TEST_ASSERT_EQUAL(2000, (int32_t)lroundf(cdeg_to_c(2000) * 100));
+}
+
+// --- per-tick benchmark: float path vs cdeg_t path ---
+static volatile uint32_t g_sink;
+static const uint32_t ITER = 300000;
+
+static uint8_t hyst_float(float temp, float sp, uint8_t prev)
+{
+  const float half = 0.5f * 0.5f;
+  if (temp >= 19.8) // double promotion, as in the old code
+    return 0;
+  if (temp < sp - half)
+    return 1;
+  if (temp > sp + half)
+    return 0;
+  return prev;
+}
+
+static uint32_t tick_float(int16_t raw, float sp, uint8_t &state)
+{
+  const float t = raw / 16.0f;
+  state = hyst_float(t, sp, state);
+  const float th[3] = {sp - 0.25f, sp + 0.25f, 19.8f};
+  float dist = 1e9f;
+  for (float x : th)
+    dist = fminf(dist, fabsf(t - x));
+  char url[16];
+  const int n = snprintf(url, sizeof(url), "%.1f", t);
+  return (uint32_t)n + state + (dist < 0.5f);
+}
+
+static uint32_t tick_cdeg(int16_t raw, cdeg_t sp, uint8_t &state)
+{
+  const cdeg_t t = cdeg_from_raw16(raw);
+  state = apply_hysteresis(t, sp, state);
+  const cdeg_t th[3] = {(cdeg_t)(sp - HYST_BAND_CD / 2), (cdeg_t)(sp + HYST_BAND_CD / 2), HEAT_CUTOFF_CD};
+  int32_t dist = INT32_MAX;
+  for (cdeg_t x : th)
+  {
+    const int32_t d = abs(t - x);
+    if (d < dist)
+      dist = d;
+  }
+  char url[8];
+  const size_t n = cdeg_format(t, url, 1);
+  return (uint32_t)n + state + (dist < 50);
+}
+
+template <typename F>
+static double nsPerTick(F f)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < ITER; ++i)
+    g_sink = g_sink + f((int16_t)(300 + (i % 64)));
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / ITER;
+}
+
+static void test_paths_agree_and_bench()
+{
+  // Same decisions on a sweep through the band (values where float rounding cannot bite)
+  uint8_t sf = 0, si = 0;
+  for (int16_t raw = 280; raw <= 330; ++raw)
+  {
+    tick_float(raw, 19.0f, sf);
+    tick_cdeg(raw, 1900, si);
+    TEST_ASSERT_EQUAL(sf, si);
+  }
+  uint8_t a = 0, b = 0;
+  const double fl = nsPerTick([&](int16_t raw) { return tick_float(raw, 19.0f, a); });
+  const double in = nsPerTick([&](int16_t raw) { return tick_cdeg(raw, 1900, b); });
+  char msg[128];
+  snprintf(msg, sizeof(msg), "tick: float %.1f ns, cdeg_t %.1f ns (x%.1f, host FPU)", fl, in, fl / in);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(in < fl);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_raw16_conversion_full_range);
+  RUN_TEST(test_format);
+  RUN_TEST(test_from_c_boundary);
+  RUN_TEST(test_paths_agree_and_bench);
+  return UNITY_END();
+}
@@ -0,0 +1,342 @@
+// Host tests for include/ds18b20.h on a mock 1-Wire bus (pio test -e native)
+// MockBus implements the OneWire calls the driver uses and models DS18B20 devices well enough
+// to count bus transactions (resets, bytes, slots) per sample.
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "ds18b20.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct MockSensor
+{
+  uint8_t rom[8];
+  int16_t raw;  // 1/16 °C
+  uint8_t cfg;  // resolution byte
+  int8_t th, tl;
+  bool parasite;
+  bool present;
+  bool corrupt; // flip a scratchpad byte after the CRC
+};
+
+class MockBus
+{
+public:
+  static const uint8_t MAX = 4;
+  MockSensor dev[MAX];
+  uint8_t count = 0;
+
+  // Transaction counters
+  uint32_t resets = 0, bytesOut = 0, bytesIn = 0, slotsIn = 0, searches = 0;
+  uint32_t busUs() const { return resets * 960 + (bytesOut + bytesIn) * 8 * 70 + slotsIn * 70; }
+  void clearCounters() { resets = bytesOut = bytesIn = slotsIn = searches = 0; }
+
+  MockSensor &add(uint8_t id, int16_t raw, bool parasite = false)
+  {
+    MockSensor &s = dev[count++];
+    const uint8_t rom[7] = {0x28, id, 0x11, 0x22, 0x33, 0x44, 0x55};
+    memcpy(s.rom, rom, 7);
+    s.rom[7] = crc8_maxim(rom, 7);
+    s.raw = raw;
+    s.cfg = 0x7F;
+    s.th = 125;
+    s.tl = -55;
+    s.parasite = parasite;
+    s.present = true;
+    s.corrupt = false;
+    return s;
+  }
+
+  // --- OneWire interface ---
+  uint8_t reset()
+  {
+    resets++;
+    state_ = ST_ROM;
+    sel_ = -1;
+    all_ = false;
+    for (uint8_t i = 0; i < count; ++i)
+      if (dev[i].present)
+        return 1;
+    return 0;
+  }
+  void skip()
+  {
+    bytesOut++;
+    all_ = true;
+    state_ = ST_FN;
+  }
+  void select(const uint8_t *rom)
+  {
+    bytesOut += 9;
+    sel_ = -1;
+    for (uint8_t i = 0; i < count; ++i)
+      if (dev[i].present && memcmp(dev[i].rom, rom, 8) == 0)
+        sel_ = (int8_t)i;
+    state_ = ST_FN;
+  }
+  void write(uint8_t v, uint8_t power = 0)
+  {
+    (void)power;
+    bytesOut++;
+    if (state_ == ST_FN)
+    {
+      fn_ = v;
+      wr_ = 0;
+      rd_ = 0;
+      state_ = ST_DATA;
+      if (v == 0x44)
+        conversions++;
+      return;
+    }
+    if (state_ == ST_DATA && fn_ == 0x4E && wr_ < 3)
+    {
+      for (uint8_t i = 0; i < count; ++i)
+        if (addressed(i))
+        {
+          if (wr_ == 0)
+            dev[i].th = (int8_t)v;
+          else if (wr_ == 1)
+            dev[i].tl = (int8_t)v;
+          else
+            dev[i].cfg = v;
+        }
+      wr_++;
+    }
+  }
+  uint8_t read()
+  {
+    bytesIn++;
+    if (state_ == ST_DATA && fn_ == 0xBE && sel_ >= 0 && rd_ < 9)
+    {
+      uint8_t sp[9];
+      scratchpad(dev[sel_], sp);
+      return sp[rd_++];
+    }
+    if (state_ == ST_DATA && fn_ == 0xB4)
+      return anyParasite() ? 0xFE : 0xFF; // only the first slot is pulled low
+    return 0xFF;
+  }
+  uint8_t read_bit()
+  {
+    slotsIn++;
+    if (state_ == ST_DATA && fn_ == 0xB4)
+      return anyParasite() ? 0 : 1;
+    return 1;
+  }
+  void reset_search() { searchIdx_ = 0; }
+  bool search(uint8_t *rom, bool searchMode = true)
+  {
+    (void)searchMode; // alarm search only in this driver
+    searches++;
+    resets++;
+    while (searchIdx_ < count)
+    {
+      const MockSensor &s = dev[searchIdx_++];
+      const int16_t whole = (int16_t)(s.raw >> 4);
+      if (s.present && (whole >= s.th || whole <= s.tl))
+      {
+        memcpy(rom, s.rom, 8);
+        bytesIn += 16; // 64 bit pairs, roughly
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint32_t conversions = 0;
+
+private:
+  enum State : uint8_t
+  {
+    ST_ROM,
+    ST_FN,
+    ST_DATA
+  };
+  bool addressed(uint8_t i) const { return dev[i].present && (all_ || sel_ == (int8_t)i); }
+  bool anyParasite() const
+  {
+    for (uint8_t i = 0; i < count; ++i)
+      if (addressed(i) && dev[i].parasite)
+        return true;
+    return false;
+  }
+  static void scratchpad(const MockSensor &s, uint8_t *sp)
+  {
+    sp[0] = (uint8_t)(s.raw & 0xFF);
+    sp[1] = (uint8_t)((uint16_t)s.raw >> 8);
+    sp[2] = (uint8_t)s.th;
+    sp[3] = (uint8_t)s.tl;
+    sp[4] = s.cfg;
+    sp[5] = 0xFF;
+    sp[6] = 0x0C;
+    sp[7] = 0x10;
+    sp[8] = crc8_maxim(sp, 8);
+    if (s.corrupt)
+      sp[1] ^= 0x01;
+  }
+
+  State state_ = ST_ROM;
+  int8_t sel_ = -1;
+  bool all_ = false;
+  uint8_t fn_ = 0, wr_ = 0, rd_ = 0, searchIdx_ = 0;
+};
+
+static void test_parasite_detection_uses_one_slot()
+{
+  MockBus bus;
+  bus.add(1, 0x0150, /*parasite=*/true);
+  Ds18b20<MockBus> ds(bus);
+  TEST_ASSERT_TRUE(ds.begin());
+  TEST_ASSERT_TRUE(ds.parasite()); // a whole-byte read would see 0xFE and miss it
+  TEST_ASSERT_EQUAL(1, bus.slotsIn);
+  TEST_ASSERT_EQUAL(0, bus.bytesIn);
+
+  MockBus ext;
+  ext.add(1, 0x0150);
+  Ds18b20<MockBus> ds2(ext);
+  TEST_ASSERT_TRUE(ds2.begin());
+  TEST_ASSERT_FALSE(ds2.parasite());
+}
+
+static void test_read_values_and_resolution_masking()
+{
+  MockBus bus;
+  bus.add(1, 0x0191); // 25.0625 °C
+  Ds18b20<MockBus> ds(bus);
+  ds.begin();
+  TEST_ASSERT_TRUE(ds.setResolution(12));
+  TEST_ASSERT_EQUAL(0x7F, bus.dev[0].cfg);
+  TEST_ASSERT_EQUAL(0x0191, ds.readRaw(bus.dev[0].rom));
+  TEST_ASSERT_EQUAL(12, ds.lastResolution());
+
+  TEST_ASSERT_TRUE(ds.setResolution(9));
+  TEST_ASSERT_EQUAL(0x1F, bus.dev[0].cfg);
+  TEST_ASSERT_EQUAL(94, ds.conversionMs());
+  TEST_ASSERT_EQUAL(0x0190, ds.readRaw(bus.dev[0].rom)); // undefined low bits cleared
+  TEST_ASSERT_EQUAL(9, ds.lastResolution());
+
+  bus.dev[0].raw = (int16_t)0xFF5E; // -10.125 °C
+  ds.setResolution(12);
+  TEST_ASSERT_EQUAL((int16_t)0xFF5E, ds.readRaw(bus.dev[0].rom));
+}
+
+static void test_errors_are_counted()
+{
+  MockBus bus;
+  MockSensor &a = bus.add(1, 0x0150);
+  MockSensor &b = bus.add(2, 0x0160);
+  Ds18b20<MockBus> ds(bus);
+  ds.begin();
+
+  a.corrupt = true;
+  TEST_ASSERT_EQUAL(DS_RAW_INVALID, ds.readRaw(a.rom));
+  TEST_ASSERT_EQUAL(DS_READ_CRC, ds.lastError());
+  TEST_ASSERT_EQUAL(1, ds.crcErrors());
+
+  a.corrupt = false;
+  a.present = false; // gone, b still answers the reset: all-ones scratchpad
+  TEST_ASSERT_EQUAL(DS_RAW_INVALID, ds.readRaw(a.rom));
+  TEST_ASSERT_EQUAL(DS_READ_NO_DATA, ds.lastError());
+
+  b.present = false; // nobody left: no presence pulse
+  TEST_ASSERT_EQUAL(DS_RAW_INVALID, ds.readRaw(b.rom));
+  TEST_ASSERT_EQUAL(DS_READ_NO_PRESENCE, ds.lastError());
+  TEST_ASSERT_EQUAL(2, ds.disconnects());
+}
+
+// Bus cost per sample: one Skip-ROM convert + one scratchpad read per sensor, nothing else
+static void test_transactions_per_sample()
+{
+  MockBus bus;
+  bus.add(1, 0x0150);
+  bus.add(2, 0x0160);
+  bus.add(3, 0x0170);
+  Ds18b20<MockBus> ds(bus);
+  ds.begin();
+  ds.setResolution(12);
+
+  const uint32_t samples = 100;
+  bus.clearCounters();
+  for (uint32_t i = 0; i < samples; ++i)
+  {
+    ds.convertAll();
+    for (uint8_t s = 0; s < bus.count; ++s)
+      TEST_ASSERT_NOT_EQUAL(DS_RAW_INVALID, ds.readRaw(bus.dev[s].rom));
+  }
+  TEST_ASSERT_EQUAL(samples * (1 + bus.count), bus.resets);
+  TEST_ASSERT_EQUAL(samples * bus.count * 9, bus.bytesIn); // no config/resolution reads
+  TEST_ASSERT_EQUAL(samples, bus.conversions);
+  const uint32_t lean = bus.busUs() / samples;
+
+  // The DallasTemperature path it replaced, per sample: getResolution() (reset, match ROM,
+  // read scratchpad) on every poll, requestTemperatures(), getTempC() per sensor
+  // (isConnected() scratchpad read + value)
+  bus.clearCounters();
+  for (uint32_t i = 0; i < samples; ++i)
+  {
+    uint8_t sp[9];
+    for (uint8_t k = 0; k < 1 + 2 * bus.count; ++k)
+    {
+      bus.reset();
+      bus.select(bus.dev[k % bus.count].rom);
+      bus.write(0xBE);
+      for (uint8_t j = 0; j < 9; ++j)
+        sp[j] = bus.read();
+    }
+    bus.reset();
+    bus.skip();
+    bus.write(0x44);
+    (void)sp;
+  }
+  const uint32_t dallas = bus.busUs() / samples;
+  char msg[128];
+  snprintf(msg, sizeof(msg), "3 sensors, bus time per sample: lean %u us, DallasTemperature-style %u us", lean,
+           dallas);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(lean * 2 < dallas);
+}
+
+static void test_alarm_search_reads_only_alarming()
+{
+  MockBus bus;
+  MockSensor &a = bus.add(1, 20 * 16);
+  bus.add(2, 20 * 16);
+  Ds18b20<MockBus> ds(bus);
+  ds.begin();
+  ds.setResolution(12); // parks TH/TL out of range
+  TEST_ASSERT_EQUAL(0, ds.alarmSearch([](const uint8_t *) {}));
+
+  TEST_ASSERT_TRUE(ds.writeAlarm(a.rom, 25, 19));
+  TEST_ASSERT_EQUAL(25, a.th);
+  TEST_ASSERT_EQUAL(19, a.tl);
+  TEST_ASSERT_EQUAL(0x7F, a.cfg); // resolution kept
+  a.raw = 18 * 16;
+  uint8_t hit[8] = {};
+  TEST_ASSERT_EQUAL(1, ds.alarmSearch([&](const uint8_t *rom) { memcpy(hit, rom, 8); }));
+  TEST_ASSERT_EQUAL_MEMORY(a.rom, hit, 8);
+  TEST_ASSERT_EQUAL(1, ds.alarmHits());
+}
+
+static void test_pick_resolution_tiers()
+{
+  TEST_ASSERT_EQUAL(12, ds_pick_resolution(-1, 9));
+  TEST_ASSERT_EQUAL(12, ds_pick_resolution(20, 9));
+  TEST_ASSERT_EQUAL(10, ds_pick_resolution(100, 9));
+  TEST_ASSERT_EQUAL(9, ds_pick_resolution(300, 9));
+  TEST_ASSERT_EQUAL(12, ds_pick_resolution(55, 12)); // inside the margin: stay fine
+  TEST_ASSERT_EQUAL(10, ds_pick_resolution(65, 12));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_parasite_detection_uses_one_slot);
+  RUN_TEST(test_read_values_and_resolution_masking);
+  RUN_TEST(test_errors_are_counted);
+  RUN_TEST(test_transactions_per_sample);
+  RUN_TEST(test_alarm_search_reads_only_alarming);
+  RUN_TEST(test_pick_resolution_tiers);
+  return UNITY_END();
+}
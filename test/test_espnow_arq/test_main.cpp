@@ -0,0 +1,189 @@
+// Lossy-link simulator for include/espnow_arq.h (pio test -e native)
+// 1 ms steps; every frame (CMD and ACK) is lost independently with probability `loss`;
+// a delivered CMD is answered after the relay RTT. The sender mirrors cmdSchedulerTick():
+// a state change arms the ArqTimer, each timeout resends until an ACK or a give-up.
+
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "espnow_arq.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t RTT_MS = 15;
+
+struct Lcg
+{
+  uint32_t s;
+  bool lost(uint16_t lossPermille)
+  {
+    s = s * 1103515245u + 12345u;
+    return (s >> 16) % 1000 < lossPermille;
+  }
+};
+
+struct ChangeResult
+{
+  uint32_t convergeMs; // UINT32_MAX: gave up
+  uint32_t frames;
+};
+
+// One state change on a link with the given loss; runs until ACKed or the ARQ gives up
+static ChangeResult simulateChange(ArqTimer &arq, LinkQuality &lq, Lcg &rng, uint16_t lossPermille)
+{
+  ChangeResult r = {UINT32_MAX, 1};
+  uint32_t now = 0;
+  std::vector<uint32_t> ackAt; // ACK arrival times in flight
+  auto send = [&](uint32_t t) {
+    if (!rng.lost(lossPermille) && !rng.lost(lossPermille))
+      ackAt.push_back(t + RTT_MS);
+  };
+  arq.start(now, ARQ_DEFAULTS);
+  send(now);
+  for (now = 1; now < 10000; ++now)
+  {
+    if (std::find(ackAt.begin(), ackAt.end(), now) != ackAt.end())
+    {
+      lq.sample(true);
+      arq.stop();
+      r.convergeMs = now;
+      return r;
+    }
+    if (arq.due(now))
+    {
+      lq.sample(false); // ACK timeout for the previous attempt
+      if (!arq.onTimeout(now, ARQ_DEFAULTS))
+        return r;
+      r.frames++;
+      send(now);
+    }
+  }
+  return r;
+}
+
+static void runLoss(uint16_t lossPermille, uint32_t &p50, uint32_t &p90, uint32_t &gaveUp, double &framesAvg)
+{
+  ArqTimer arq;
+  arq.seed(12345);
+  LinkQuality lq;
+  Lcg rng = {lossPermille * 7919u + 1};
+  std::vector<uint32_t> ms;
+  uint64_t frames = 0;
+  gaveUp = 0;
+  const uint32_t changes = 5000;
+  for (uint32_t i = 0; i < changes; ++i)
+  {
+    ChangeResult r = simulateChange(arq, lq, rng, lossPermille);
+    frames += r.frames;
+    if (r.convergeMs == UINT32_MAX)
+      gaveUp++;
+    ms.push_back(r.convergeMs);
+  }
+  std::sort(ms.begin(), ms.end());
+  p50 = ms[ms.size() / 2];
+  p90 = ms[ms.size() * 9 / 10];
+  framesAvg = (double)frames / changes;
+  char msg[160];
+  snprintf(msg, sizeof(msg), "loss %u%% each way: p50 %u ms, p90 %u ms, gave up %u/%u, %.2f frames/change",
+           lossPermille / 10, p50, p90, gaveUp, changes, framesAvg);
+  TEST_MESSAGE(msg);
+}
+
+static void test_clean_link_converges_on_first_frame()
+{
+  uint32_t p50, p90, gaveUp;
+  double frames;
+  runLoss(0, p50, p90, gaveUp, frames);
+  TEST_ASSERT_EQUAL(RTT_MS, p90);
+  TEST_ASSERT_EQUAL(0, gaveUp);
+  TEST_ASSERT_TRUE(frames < 1.001);
+}
+
+// 20 % loss each way (36 % of round trips fail): sub-second convergence, no flooding
+static void test_lossy_link_sub_second()
+{
+  uint32_t p50, p90, gaveUp;
+  double frames;
+  runLoss(200, p50, p90, gaveUp, frames);
+  TEST_ASSERT_TRUE(p50 < 100);
+  TEST_ASSERT_TRUE(p90 < 1000);
+  TEST_ASSERT_TRUE(gaveUp < 5000 / 100);
+  TEST_ASSERT_TRUE(frames < 2.0);
+}
+
+// 40 % loss each way (64 % of round trips fail): still converges, frames bounded by maxRetries
+static void test_bad_link_bounded_frames()
+{
+  uint32_t p50, p90, gaveUp;
+  double frames;
+  runLoss(400, p50, p90, gaveUp, frames);
+  TEST_ASSERT_TRUE(p50 < 1000);
+  TEST_ASSERT_TRUE(frames <= 1.0 + ARQ_DEFAULTS.maxRetries);
+}
+
+static void test_backoff_schedule_and_jitter()
+{
+  ArqTimer arq;
+  arq.seed(1);
+  arq.start(0, ARQ_DEFAULTS);
+  uint32_t now = 0, prev = 0, expect = ARQ_DEFAULTS.baseMs;
+  uint8_t resends = 0;
+  while (now < 20000)
+  {
+    ++now;
+    if (!arq.due(now))
+      continue;
+    const uint32_t gap = now - prev;
+    const uint32_t span = expect * ARQ_DEFAULTS.jitterPct / 100;
+    TEST_ASSERT_TRUE(gap >= expect - span && gap <= expect + span);
+    prev = now;
+    if (!arq.onTimeout(now, ARQ_DEFAULTS))
+      break;
+    resends++;
+    expect = std::min<uint32_t>(expect * 2, ARQ_DEFAULTS.maxMs);
+  }
+  TEST_ASSERT_EQUAL(ARQ_DEFAULTS.maxRetries, resends);
+  TEST_ASSERT_FALSE(arq.active());
+  TEST_ASSERT_EQUAL(1, arq.giveUps());
+}
+
+// Dead link: the estimate falls below DOWN_BELOW within a dozen lost frames, recovers with hysteresis
+static void test_link_down_and_recovery()
+{
+  LinkQuality lq;
+  uint8_t n = 0;
+  while (!lq.down() && n < 50)
+  {
+    lq.sample(false);
+    n++;
+  }
+  TEST_ASSERT_TRUE(lq.down());
+  TEST_ASSERT_TRUE(n <= 12);
+  TEST_ASSERT_EQUAL(1, lq.downEvents());
+  lq.sample(true);
+  TEST_ASSERT_TRUE(lq.down()); // one ACK is not enough to flip back
+  n = 1;
+  while (lq.down() && n < 50)
+  {
+    lq.sample(true);
+    n++;
+  }
+  TEST_ASSERT_FALSE(lq.down());
+  TEST_ASSERT_TRUE(lq.permille() >= LinkQuality::UP_FROM);
+  for (uint8_t i = 0; i < 200; ++i)
+    lq.sample(true);
+  TEST_ASSERT_TRUE(lq.permille() <= 1000);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_link_converges_on_first_frame);
+  RUN_TEST(test_lossy_link_sub_second);
+  RUN_TEST(test_bad_link_bounded_frames);
+  RUN_TEST(test_backoff_schedule_and_jitter);
+  RUN_TEST(test_link_down_and_recovery);
+  return UNITY_END();
+}
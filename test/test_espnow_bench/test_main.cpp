@@ -0,0 +1,98 @@
+// Host benchmark: binary ESP-NOW frame vs the ArduinoJson path it replaced (pio test -e native)
+// - JSON CMD: JsonDocument {"heater":"ON","id":12} serialized into a 32-byte buffer
+// - JSON ACK: deserializeJson of {"ack":"ON","relay":1,"ok":true,"seq":n,"id":12}
+// Host ns are not ESP8266 us, but the ratio carries over (both paths are pure CPU work)
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "espnow_frame.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t ITER = 200000;
+static volatile uint32_t g_sink; // keeps the optimiser from dropping the work
+
+template <typename F>
+static double nsPerOp(F f)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < ITER; ++i)
+    f(i);
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / ITER;
+}
+
+static void report(const char *what, double bin, double json)
+{
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%s: binary %.1f ns, ArduinoJson %.1f ns (x%.0f)", what, bin, json, json / bin);
+  TEST_MESSAGE(msg);
+}
+
+static void test_json_and_binary_agree()
+{
+  JsonDocument doc;
+  TEST_ASSERT_FALSE(deserializeJson(doc, "{\"ack\":\"ON\",\"relay\":1,\"ok\":true,\"seq\":513,\"id\":12}"));
+  EfFrame f = {EF_ACK, (uint8_t)(doc["id"] | 0), (uint16_t)(doc["seq"] | 0L), (uint8_t)(doc["relay"] | 0),
+               (uint8_t)((doc["ok"] | false) ? EF_FLAG_OK : 0)};
+  uint8_t buf[EF_FRAME_LEN];
+  ef_encode(f, buf, sizeof(buf));
+  EfFrame g = {};
+  TEST_ASSERT_EQUAL(EF_DECODED, ef_decode(buf, sizeof(buf), g));
+  TEST_ASSERT_EQUAL(12, g.zone);
+  TEST_ASSERT_EQUAL(513, g.seq);
+  TEST_ASSERT_EQUAL(1, g.value);
+  TEST_ASSERT_EQUAL(EF_FLAG_OK, g.flags);
+}
+
+static void test_bench_encode()
+{
+  const double bin = nsPerOp([](uint32_t i) {
+    uint8_t buf[32];
+    EfFrame f = {EF_CMD, 12, (uint16_t)i, (uint8_t)(i & 1), 0};
+    g_sink = g_sink + (uint32_t)ef_encode(f, buf, sizeof(buf)) + buf[8];
+  });
+  const double json = nsPerOp([](uint32_t i) {
+    char buf[32];
+    JsonDocument doc;
+    doc["heater"] = (i & 1) ? "ON" : "OFF";
+    doc["id"] = 12;
+    g_sink = g_sink + (uint32_t)serializeJson(doc, buf, sizeof(buf)) + (uint8_t)buf[2];
+  });
+  report("encode CMD", bin, json);
+  TEST_ASSERT_TRUE(bin < json);
+}
+
+static void test_bench_decode()
+{
+  uint8_t frame[EF_FRAME_LEN];
+  EfFrame f = {EF_ACK, 12, 513, 1, EF_FLAG_OK};
+  ef_encode(f, frame, sizeof(frame));
+  static const char ack[] = "{\"ack\":\"ON\",\"relay\":1,\"ok\":true,\"seq\":513,\"id\":12}";
+
+  const double bin = nsPerOp([&](uint32_t) {
+    EfFrame g;
+    if (ef_decode(frame, sizeof(frame), g) == EF_DECODED)
+      g_sink = g_sink + g.seq + g.value;
+  });
+  const double json = nsPerOp([&](uint32_t) {
+    JsonDocument doc;
+    if (!deserializeJson(doc, ack, sizeof(ack) - 1))
+      g_sink = g_sink + (uint32_t)(doc["seq"] | 0L) + (uint32_t)(doc["relay"] | 0);
+  });
+  report("decode ACK", bin, json);
+  TEST_ASSERT_TRUE(bin < json);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_json_and_binary_agree);
+  RUN_TEST(test_bench_encode);
+  RUN_TEST(test_bench_decode);
+  return UNITY_END();
+}
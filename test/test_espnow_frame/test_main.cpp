@@ -0,0 +1,87 @@
+// Host tests for include/espnow_frame.h and include/crc8.h (pio test -e native)
+
+#include <unity.h>
+#include <string.h>
+#include "espnow_frame.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_crc8_maxim_known_vectors()
+{
+  // ROM code of the worked example in Maxim application note 27: CRC in the last byte
+  const uint8_t rom[8] = {0x02, 0x1C, 0xB8, 0x01, 0x00, 0x00, 0x00, 0xA2};
+  TEST_ASSERT_EQUAL_HEX8(crc8_maxim(rom, 7), rom[7]);
+  // Appending the CRC to the data gives 0 (property of this CRC)
+  TEST_ASSERT_EQUAL_HEX8(0, crc8_maxim(rom, 8));
+  const uint8_t check[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  TEST_ASSERT_EQUAL_HEX8(0xA1, crc8_maxim(check, 9)); // CRC-8/MAXIM check value
+  TEST_ASSERT_EQUAL_HEX8(0, crc8_maxim(check, 0));
+}
+
+static void test_encode_layout()
+{
+  EfFrame f = {EF_CMD, 12, 0x1234, 1, 0};
+  uint8_t buf[16];
+  TEST_ASSERT_EQUAL(EF_FRAME_LEN, ef_encode(f, buf, sizeof(buf)));
+  const uint8_t want[8] = {EF_MAGIC, EF_VERSION, EF_CMD, 12, 0x34, 0x12, 1, 0};
+  TEST_ASSERT_EQUAL_MEMORY(want, buf, 8);
+  TEST_ASSERT_EQUAL_HEX8(crc8_maxim(buf, 8), buf[8]);
+  TEST_ASSERT_TRUE(ef_is_binary(buf, EF_FRAME_LEN));
+  TEST_ASSERT_FALSE(ef_is_binary((const uint8_t *)"{\"heater\":\"ON\"}", 15));
+  TEST_ASSERT_EQUAL(0, ef_encode(f, buf, EF_FRAME_LEN - 1));
+}
+
+static void test_roundtrip_all_fields()
+{
+  for (uint32_t seq = 0; seq <= 0xFFFF; seq += 257)
+  {
+    EfFrame f = {EF_ACK, (uint8_t)seq, (uint16_t)seq, (uint8_t)(seq & 1), EF_FLAG_OK};
+    uint8_t buf[EF_FRAME_LEN];
+    ef_encode(f, buf, sizeof(buf));
+    EfFrame g = {};
+    TEST_ASSERT_EQUAL(EF_DECODED, ef_decode(buf, sizeof(buf), g));
+    TEST_ASSERT_EQUAL(f.type, g.type);
+    TEST_ASSERT_EQUAL(f.zone, g.zone);
+    TEST_ASSERT_EQUAL(f.seq, g.seq);
+    TEST_ASSERT_EQUAL(f.value, g.value);
+    TEST_ASSERT_EQUAL(f.flags, g.flags);
+  }
+}
+
+static void test_decode_rejects()
+{
+  EfFrame f = {EF_CMD, 3, 7, 1, 0};
+  uint8_t buf[EF_FRAME_LEN];
+  ef_encode(f, buf, sizeof(buf));
+  EfFrame g;
+  TEST_ASSERT_EQUAL(EF_ERR_SHORT, ef_decode(buf, EF_FRAME_LEN - 1, g));
+
+  uint8_t bad[EF_FRAME_LEN];
+  memcpy(bad, buf, sizeof(bad));
+  bad[0] = '{';
+  TEST_ASSERT_EQUAL(EF_ERR_MAGIC, ef_decode(bad, sizeof(bad), g));
+
+  memcpy(bad, buf, sizeof(bad));
+  bad[1] = EF_VERSION + 1;
+  TEST_ASSERT_EQUAL(EF_ERR_VERSION, ef_decode(bad, sizeof(bad), g));
+
+  // Every single-bit error in the payload is caught by the CRC
+  for (uint8_t i = 2; i < EF_FRAME_LEN; ++i)
+    for (uint8_t b = 0; b < 8; ++b)
+    {
+      memcpy(bad, buf, sizeof(bad));
+      bad[i] ^= (uint8_t)(1u << b);
+      TEST_ASSERT_EQUAL(EF_ERR_CRC, ef_decode(bad, sizeof(bad), g));
+    }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_crc8_maxim_known_vectors);
+  RUN_TEST(test_encode_layout);
+  RUN_TEST(test_roundtrip_all_fields);
+  RUN_TEST(test_decode_rejects);
+  return UNITY_END();
+}
@@ -0,0 +1,136 @@
+// Host tests for include/espnow_stats.h: ACK matching in the in-flight table when every zone
+// sends in the same control tick, with and without ARQ resends pending (pio test -e native)
+
+#include <unity.h>
+#include <stdio.h>
+#include "espnow_stats.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_match_duplicate_stale()
+{
+  InflightTable<4> t;
+  uint32_t rtt = 0;
+  uint8_t tag = 0xFF;
+  t.add(100, 1000, 3);
+  TEST_ASSERT_EQUAL(ACK_MATCHED, t.match(100, 1040, rtt, tag));
+  TEST_ASSERT_EQUAL(40, rtt);
+  TEST_ASSERT_EQUAL(3, tag);
+  TEST_ASSERT_EQUAL(ACK_DUPLICATE, t.match(100, 1050, rtt));
+  TEST_ASSERT_EQUAL(ACK_STALE, t.match(101, 1050, rtt));
+  t.expire(2000, 1000);
+  TEST_ASSERT_EQUAL(ACK_STALE, t.match(100, 2010, rtt)); // released after the timeout
+  TEST_ASSERT_EQUAL(0, t.lost());
+}
+
+static void test_expire_reports_lost_tag()
+{
+  InflightTable<4> t;
+  uint8_t lostTag = 0xFF;
+  t.add(7, 0xFFFFFF00UL, 2); // sent 256 ms before the millis() rollover
+  t.expire(700, 1000, [&](uint8_t z) { lostTag = z; });
+  TEST_ASSERT_EQUAL(0xFF, lostTag);
+  t.expire(744, 1000, [&](uint8_t z) { lostTag = z; });
+  TEST_ASSERT_EQUAL(2, lostTag);
+  TEST_ASSERT_EQUAL(1, t.lost());
+  TEST_ASSERT_EQUAL(1000, t.lossPermille());
+}
+
+// Every zone sends in one tick (boot, or the shared heartbeat); the ACKs come back in reverse order
+template <uint8_t N>
+static uint32_t all_zones_one_tick(InflightTable<N> &t)
+{
+  for (uint8_t z = 0; z < ESPNOW_MAX_ZONES; ++z)
+    t.add((uint16_t)(500 + z), 1000, z);
+  uint32_t rtt = 0, stale = 0;
+  for (uint8_t z = ESPNOW_MAX_ZONES; z-- > 0;)
+  {
+    uint8_t tag = 0xFF;
+    if (t.match((uint16_t)(500 + z), 1030, rtt, tag) != ACK_MATCHED)
+      stale++;
+    else if (tag != z)
+      stale += 100; // matched the wrong zone
+  }
+  return stale;
+}
+
+static void test_all_zones_same_tick()
+{
+  InflightTable<ESPNOW_INFLIGHT_SLOTS> t;
+  TEST_ASSERT_EQUAL(0, all_zones_one_tick(t));
+  TEST_ASSERT_EQUAL(ESPNOW_MAX_ZONES, t.acked());
+  TEST_ASSERT_EQUAL(0, t.lost());
+  TEST_ASSERT_EQUAL(0, t.stale());
+  // The old 8-slot table evicted two live entries, and dropped their real ACKs as stale
+  InflightTable<8> small;
+  TEST_ASSERT_EQUAL(2, all_zones_one_tick(small));
+  TEST_ASSERT_EQUAL(2, small.lost());
+}
+
+// Slow link: every zone changes state in the same tick and the relays answer each frame 900 ms
+// later, so the ARQ resends (fresh seq each, as espnowSendHeater does) pile up in the table
+static void test_all_zones_with_retries_pending()
+{
+  struct Ack
+  {
+    uint16_t seq;
+    uint32_t atMs;
+  };
+  static Ack acks[ESPNOW_MAX_ZONES * (1 + ARQ_MAX_RETRIES)];
+  uint8_t nAcks = 0;
+  InflightTable<ESPNOW_INFLIGHT_SLOTS> t;
+  ArqTimer arq[ESPNOW_MAX_ZONES];
+  uint16_t seq = 0;
+  uint8_t maxPending = 0;
+  const uint32_t t0 = 0xFFFFFFFFUL - 500; // through the millis() rollover too
+  for (uint8_t z = 0; z < ESPNOW_MAX_ZONES; ++z)
+  {
+    arq[z].seed(z + 1u);
+    arq[z].start(t0, ARQ_DEFAULTS);
+    t.add(++seq, t0, z);
+    acks[nAcks++] = {seq, t0 + 900};
+  }
+  uint32_t rtt = 0;
+  for (uint32_t ms = 1; ms <= 3000; ++ms)
+  {
+    const uint32_t now = t0 + ms;
+    for (uint8_t i = 0; i < nAcks; ++i)
+      if (acks[i].atMs == now)
+      {
+        uint8_t z = 0xFF;
+        const AckMatch m = t.match(acks[i].seq, now, rtt, z);
+        TEST_ASSERT_NOT_EQUAL(ACK_STALE, m);
+        if (m == ACK_MATCHED)
+          arq[z].stop(); // relay confirmed the state (cmdNoteAck)
+      }
+    for (uint8_t z = 0; z < ESPNOW_MAX_ZONES; ++z)
+      if (arq[z].due(now) && arq[z].onTimeout(now, ARQ_DEFAULTS))
+      {
+        t.add(++seq, now, z);
+        acks[nAcks++] = {seq, now + 900};
+      }
+    if (t.pending() > maxPending)
+      maxPending = t.pending();
+    t.expire(now, 1000); // ACK_TIMEOUT_MS
+  }
+  char msg[120];
+  snprintf(msg, sizeof(msg), "%u zones: %u frames, %u acked, peak %u pending of %u slots", ESPNOW_MAX_ZONES,
+           t.sent(), t.acked(), maxPending, ESPNOW_INFLIGHT_SLOTS);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(t.sent() > 3u * ESPNOW_MAX_ZONES); // resends really were in flight together
+  TEST_ASSERT_EQUAL(t.sent(), t.acked());
+  TEST_ASSERT_EQUAL(0, t.lost());
+  TEST_ASSERT_EQUAL(0, t.stale());
+  TEST_ASSERT_TRUE(maxPending <= ESPNOW_INFLIGHT_SLOTS);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_match_duplicate_stale);
+  RUN_TEST(test_expire_reports_lost_tag);
+  RUN_TEST(test_all_zones_same_tick);
+  RUN_TEST(test_all_zones_with_retries_pending);
+  return UNITY_END();
+}
@@ -0,0 +1,155 @@
+// Host tests for include/heat_control.h: hysteresis, stale readings, and the heater output
+// state machine, including runs across the 49.7-day millis() rollover (pio test -e native)
+
+#include <unity.h>
+#include "heat_control.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const HeaterConfig NO_MAX = {180000UL, 180000UL, 0, 0}; // maxOnMs = 0: no limit
+static const uint32_t NEAR_WRAP = 0xFFFFFFFFUL - 60000UL;      // millis() a minute before rollover
+
+static void test_hysteresis_band_and_cutoff()
+{
+  TEST_ASSERT_EQUAL(1, apply_hysteresis(1874, 1900, 0)); // < sp - 0.25
+  TEST_ASSERT_EQUAL(0, apply_hysteresis(1875, 1900, 0)); // on the threshold: hold
+  TEST_ASSERT_EQUAL(1, apply_hysteresis(1925, 1900, 1)); // on the threshold: hold
+  TEST_ASSERT_EQUAL(0, apply_hysteresis(1926, 1900, 1)); // > sp + 0.25
+  TEST_ASSERT_EQUAL(0, apply_hysteresis(1980, 2500, 1)); // cutoff whatever the setpoint
+  TEST_ASSERT_EQUAL(1, apply_hysteresis(1979, 2500, 0));
+}
+
+static void test_stale_reading_is_dropped()
+{
+  TEST_ASSERT_EQUAL(1900, temp_if_fresh(1900, 1000, 5999, 5000));
+  TEST_ASSERT_EQUAL(CDEG_INVALID, temp_if_fresh(1900, 1000, 6000, 5000));
+  TEST_ASSERT_EQUAL(CDEG_INVALID, temp_if_fresh(CDEG_INVALID, 1000, 1000, 5000));
+  // Sample taken 1 s before the rollover, checked 2 s and 5 s later
+  TEST_ASSERT_EQUAL(1900, temp_if_fresh(1900, 0xFFFFFC18UL, 1000, 5000));
+  TEST_ASSERT_EQUAL(CDEG_INVALID, temp_if_fresh(1900, 0xFFFFFC18UL, 4000, 5000));
+}
+
+// A sensor lost while heating: the frozen value ages out and the output drops inside minOnMs
+static void test_lost_sensor_forces_off()
+{
+  HeaterOutput o;
+  uint32_t now = 1;
+  const cdeg_t temp = 1800;
+  const uint32_t at = now;
+  TEST_ASSERT_TRUE(o.update(true, false, now, HEATER_DEFAULTS));
+  for (now += 1000; now < 60000; now += 1000) // no sample since `at`
+  {
+    const cdeg_t t = temp_if_fresh(temp, at, now, 5000);
+    const bool want = cdeg_valid(t) && apply_hysteresis(t, 1900, 1) == 1;
+    o.update(want, !cdeg_valid(t), now, HEATER_DEFAULTS);
+  }
+  TEST_ASSERT_FALSE(o.on());
+  TEST_ASSERT_EQUAL(1, o.forcedOffs());
+}
+
+static void test_min_times_defer_requests()
+{
+  HeaterOutput o;
+  TEST_ASSERT_TRUE(o.update(true, false, 1, HEATER_DEFAULTS)); // boot: no dwell owed
+  TEST_ASSERT_TRUE(o.update(false, false, 60000, HEATER_DEFAULTS));
+  TEST_ASSERT_TRUE(o.update(false, false, 120000, HEATER_DEFAULTS)); // same deferral
+  TEST_ASSERT_EQUAL(1, o.heldOn());
+  TEST_ASSERT_FALSE(o.update(false, false, 180001, HEATER_DEFAULTS));
+  TEST_ASSERT_FALSE(o.update(true, false, 200000, HEATER_DEFAULTS));
+  TEST_ASSERT_EQUAL(1, o.heldOff());
+  TEST_ASSERT_TRUE(o.update(true, false, 360001, HEATER_DEFAULTS));
+  TEST_ASSERT_EQUAL(2, o.cycles());
+}
+
+static void test_force_off_skips_min_on()
+{
+  HeaterOutput o;
+  o.update(true, false, 1, HEATER_DEFAULTS);
+  TEST_ASSERT_FALSE(o.update(true, true, 1000, HEATER_DEFAULTS));
+  TEST_ASSERT_EQUAL(HE_OFF, o.event());
+  TEST_ASSERT_EQUAL(1, o.forcedOffs());
+}
+
+static void test_max_on_cooldown_and_release()
+{
+  HeaterOutput o;
+  uint32_t now = 1;
+  o.update(true, false, now, HEATER_DEFAULTS);
+  for (; o.state() == HS_ON; now += 1000)
+    o.update(true, false, now, HEATER_DEFAULTS);
+  TEST_ASSERT_EQUAL(HE_COOLDOWN, o.event());
+  TEST_ASSERT_EQUAL(1, o.cooldowns());
+  const uint32_t start = now - 1000;
+  TEST_ASSERT_EQUAL(3600000UL, start - 1);
+  for (; o.state() == HS_COOLDOWN; now += 1000)
+    TEST_ASSERT_FALSE(o.update(true, false, now, HEATER_DEFAULTS));
+  TEST_ASSERT_EQUAL(HE_RELEASED, o.event());
+  TEST_ASSERT_TRUE(o.update(true, false, now, HEATER_DEFAULTS)); // cooldown covered minOffMs
+}
+
+// Every dwell straddling the rollover: ON/OFF just before, minimum times checked just after
+static void test_min_times_across_rollover()
+{
+  HeaterOutput o;
+  uint32_t now = NEAR_WRAP;
+  o.update(false, false, now, HEATER_DEFAULTS);
+  TEST_ASSERT_TRUE(o.update(true, false, now += 1000, HEATER_DEFAULTS));
+  TEST_ASSERT_TRUE(o.update(false, false, now += 100000, HEATER_DEFAULTS)); // wrapped: 101 s ON
+  TEST_ASSERT_TRUE(now < NEAR_WRAP);
+  TEST_ASSERT_FALSE(o.update(false, false, now += 80000, HEATER_DEFAULTS)); // 181 s ON
+  TEST_ASSERT_FALSE(o.update(true, false, now += 179000, HEATER_DEFAULTS));
+  TEST_ASSERT_TRUE(o.update(true, false, now += 1000, HEATER_DEFAULTS));
+}
+
+static void test_max_on_across_rollover()
+{
+  HeaterOutput o;
+  uint32_t now = NEAR_WRAP - 3000000UL;
+  o.update(true, false, now, HEATER_DEFAULTS);
+  const uint32_t since = now;
+  while (o.state() == HS_ON)
+    o.update(true, false, now += 1000, HEATER_DEFAULTS);
+  TEST_ASSERT_EQUAL(HEATER_DEFAULTS.maxOnMs, now - since); // exactly 1 h, through the wrap
+}
+
+// Fast-forward a state held for more than 2^32 ms (49.7 days): the elapsed time wraps back below
+// the minimum, which must not re-arm it. Step 60 s, request the change at the worst tick.
+static void hold_past_wrap(bool on)
+{
+  HeaterOutput o;
+  uint32_t now = NEAR_WRAP;
+  o.update(true, false, now, NO_MAX);  // boot
+  o.update(on, false, now += 1, NO_MAX); // no-op for on, deferred OFF otherwise: stays ON
+  if (!on)
+  {
+    o.update(false, false, now += NO_MAX.minOnMs, NO_MAX);
+    TEST_ASSERT_FALSE(o.on());
+  }
+  const uint32_t since = now;
+  uint64_t held = 0;
+  for (; held < 0x100000000ULL + 60000; held += 60000) // past one full wrap of the elapsed time
+    TEST_ASSERT_EQUAL(on, o.update(on, false, now += 60000, NO_MAX));
+  TEST_ASSERT_TRUE(now - since < NO_MAX.minOnMs); // the raw elapsed time is back below the minimum
+  TEST_ASSERT_EQUAL(!on, o.update(!on, false, now += 1000, NO_MAX));
+  TEST_ASSERT_EQUAL(on ? HE_OFF : HE_ON, o.event());
+}
+
+static void test_on_held_past_wrap_still_turns_off() { hold_past_wrap(true); }
+static void test_off_held_past_wrap_still_turns_on() { hold_past_wrap(false); }
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_hysteresis_band_and_cutoff);
+  RUN_TEST(test_stale_reading_is_dropped);
+  RUN_TEST(test_lost_sensor_forces_off);
+  RUN_TEST(test_min_times_defer_requests);
+  RUN_TEST(test_force_off_skips_min_on);
+  RUN_TEST(test_max_on_cooldown_and_release);
+  RUN_TEST(test_min_times_across_rollover);
+  RUN_TEST(test_max_on_across_rollover);
+  RUN_TEST(test_on_held_past_wrap_still_turns_off);
+  RUN_TEST(test_off_held_past_wrap_still_turns_on);
+  return UNITY_END();
+}
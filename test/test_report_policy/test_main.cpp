@@ -0,0 +1,197 @@
+// Host tests for include/report_policy.h: triggers, retry, force, millis() wrap, and one
+// simulated day of the 1.5 s report task against the old send-every-tick loop (pio test -e native)
+
+#include <unity.h>
+#include <stdio.h>
+#include "report_policy.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const ReportConfig C = REPORT_DEFAULTS; // 0.2 °C, 300 s heartbeat, 30 s pull, 5 s retry
+
+// First report, then one successful exchange at t
+static void start(ReportPolicy &p, cdeg_t temp, bool cald, uint32_t t)
+{
+  TEST_ASSERT_EQUAL(RR_FIRST, p.due(C, temp, cald, t));
+  p.done(RR_FIRST, true, temp, cald, t);
+}
+
+static void test_first_then_quiet()
+{
+  ReportPolicy p;
+  start(p, 1900, false, 1000);
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, 1900, false, 2500));
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, 1919, false, 30999)); // < delta, < pull
+  TEST_ASSERT_EQUAL(1, p.count(RR_FIRST));
+  TEST_ASSERT_EQUAL(1900, p.sentTemp());
+}
+
+static void test_delta_both_ways_against_sent_value()
+{
+  ReportPolicy p;
+  start(p, 1900, false, 1000);
+  TEST_ASSERT_EQUAL(RR_DELTA, p.due(C, 1920, false, 2000));
+  TEST_ASSERT_EQUAL(RR_DELTA, p.due(C, 1880, false, 2000));
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, 1881, false, 2000));
+  // Slow drift: compared against the value sent, not the previous sample
+  cdeg_t t = 1900;
+  uint32_t now = 2000;
+  uint8_t why = RR_NONE;
+  while ((why = p.due(C, t, false, now)) == RR_NONE || why == RR_PULL)
+  {
+    if (why == RR_PULL)
+      p.done(why, true, t, false, now);
+    t++;
+    now += 1500;
+  }
+  TEST_ASSERT_EQUAL(RR_DELTA, why);
+  TEST_ASSERT_EQUAL(1920, t);
+}
+
+static void test_cald_change()
+{
+  ReportPolicy p;
+  start(p, 1900, false, 1000);
+  TEST_ASSERT_EQUAL(RR_CALD, p.due(C, 1900, true, 2500));
+  p.done(RR_CALD, true, 1900, true, 2500);
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, 1900, true, 4000));
+  TEST_ASSERT_TRUE(p.sentCald());
+}
+
+static void test_pull_and_heartbeat()
+{
+  ReportPolicy p;
+  start(p, 1900, false, 1000);
+  uint32_t now = 1000;
+  for (int i = 0; i < 9; ++i) // pulls every 30 s keep the reply timer fresh, not the report one
+  {
+    now += C.pullMs;
+    TEST_ASSERT_EQUAL(RR_PULL, p.due(C, 1900, false, now));
+    p.done(RR_PULL, true, 1900, false, now);
+  }
+  TEST_ASSERT_EQUAL(1000, p.sentMs());
+  TEST_ASSERT_EQUAL(RR_HEARTBEAT, p.due(C, 1900, false, 1000 + C.heartbeatMs));
+  p.done(RR_HEARTBEAT, true, 1900, false, 1000 + C.heartbeatMs);
+  TEST_ASSERT_EQUAL(1000 + C.heartbeatMs, p.sentMs());
+  TEST_ASSERT_EQUAL(9, p.count(RR_PULL));
+}
+
+static void test_invalid_temp_only_pulls()
+{
+  ReportPolicy p;
+  TEST_ASSERT_EQUAL(RR_PULL, p.due(C, CDEG_INVALID, true, 1000)); // never reported, still pulls
+  p.done(RR_PULL, true, CDEG_INVALID, true, 1000);
+  TEST_ASSERT_FALSE(p.sent());
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, CDEG_INVALID, true, 2000));
+  TEST_ASSERT_EQUAL(RR_FIRST, p.due(C, 1900, true, 2000)); // sensor back
+}
+
+static void test_failure_waits_retry_and_keeps_pending()
+{
+  ReportPolicy p;
+  start(p, 1900, false, 1000);
+  TEST_ASSERT_EQUAL(RR_CALD, p.due(C, 1900, true, 2000));
+  p.done(RR_CALD, false, 1900, true, 2000);
+  TEST_ASSERT_EQUAL(1, p.fails());
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, 1900, true, 2000 + C.retryMs - 1));
+  TEST_ASSERT_EQUAL(RR_CALD, p.due(C, 1900, true, 2000 + C.retryMs)); // still pending
+  TEST_ASSERT_FALSE(p.sentCald());
+}
+
+static void test_force()
+{
+  ReportPolicy p;
+  start(p, 1900, false, 1000);
+  p.force();
+  TEST_ASSERT_EQUAL(RR_FORCED, p.due(C, 1900, false, 1500));
+  p.done(RR_FORCED, false, 1900, false, 1500); // failed: stays forced
+  TEST_ASSERT_EQUAL(RR_FORCED, p.due(C, 1900, false, 1500 + C.retryMs));
+  p.done(RR_FORCED, true, 1900, false, 1500 + C.retryMs);
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, 1900, false, 1500 + C.retryMs + 1));
+  // Without a valid reading the forced request is a pull (e.g. sleep with a dead sensor)
+  ReportPolicy q;
+  q.force();
+  TEST_ASSERT_EQUAL(RR_PULL, q.due(C, CDEG_INVALID, false, 1));
+}
+
+static void test_timers_across_millis_wrap()
+{
+  const uint32_t t0 = 0xFFFFFFFFUL - 10000; // 10 s before the rollover
+  ReportPolicy p;
+  start(p, 1900, false, t0);
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, 1900, false, t0 + 20000)); // wrapped, 20 s later
+  TEST_ASSERT_EQUAL(RR_PULL, p.due(C, 1900, false, t0 + C.pullMs));
+  p.done(RR_CALD, false, 1900, true, t0 + 5000); // failed just before the wrap
+  TEST_ASSERT_EQUAL(RR_NONE, p.due(C, 1900, true, t0 + 5000 + C.retryMs - 1));
+  TEST_ASSERT_EQUAL(RR_CALD, p.due(C, 1900, true, t0 + 5000 + C.retryMs));
+  p.done(RR_CALD, true, 1900, true, t0 + 20000);
+  TEST_ASSERT_EQUAL(RR_HEARTBEAT, p.due(C, 1900, true, t0 + 20000 + C.heartbeatMs));
+}
+
+// One day of the 1.5 s report task: ±0.3 °C swing (20 min period) plus 1/16 °C sensor noise,
+// relay changes every 30 min, 1 request in 50 failing, started 12 h before the millis() rollover
+static void test_day_request_count()
+{
+  ReportPolicy p;
+  uint32_t lcg = 1, n = 0, ticks = 0, caldLate = 0;
+  uint32_t maxGapMs = 0, lastOk = 0, caldAt = 0;
+  bool prevCald = true;
+  const uint32_t t0 = 0xFFFFFFFFUL - 12UL * 3600000UL;
+  for (uint32_t el = 0; el < 86400000UL; el += 1500, ticks++)
+  {
+    const uint32_t now = t0 + el;
+    const uint32_t s = el / 1000;
+    const int32_t ph = (int32_t)(s % 1200);
+    const int32_t tri = ph < 600 ? ph : 1200 - ph; // 0..600
+    lcg = lcg * 1103515245u + 12345u;
+    const cdeg_t temp = (cdeg_t)(1870 + tri / 10 + (int32_t)((lcg >> 16) % 3) * 6 - 6);
+    const bool cald = (s / 1800) % 2 == 0;
+    if (cald != prevCald)
+    {
+      prevCald = cald;
+      caldAt = now;
+    }
+    const uint8_t why = p.due(C, temp, cald, now);
+    if (why != RR_NONE)
+    {
+      const bool ok = ++n % 50 != 0;
+      p.done(why, ok, temp, cald, now);
+      if (ok)
+      {
+        if (lastOk && now - lastOk > maxGapMs)
+          maxGapMs = now - lastOk;
+        lastOk = now;
+      }
+    }
+    if (p.sentCald() != cald && now - caldAt > C.retryMs + 1500)
+      caldLate++; // a relay change not on the server after one retry
+  }
+  char msg[200];
+  snprintf(msg, sizeof(msg),
+           "1 day: %u requests vs %u (every tick): %u delta, %u cald, %u heartbeat, %u pull, %u failed; max gap %u s",
+           n, ticks, p.count(RR_DELTA), p.count(RR_CALD), p.count(RR_HEARTBEAT), p.count(RR_PULL), p.fails(),
+           maxGapMs / 1000);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(57600, ticks);
+  TEST_ASSERT_TRUE(n * 15 < ticks);                          // > 15x fewer requests
+  TEST_ASSERT_TRUE(maxGapMs <= C.pullMs + C.retryMs + 1500); // replies never further apart than a pull + retry
+  TEST_ASSERT_EQUAL(0, caldLate);
+  TEST_ASSERT_TRUE(p.count(RR_DELTA) > 0);
+  TEST_ASSERT_TRUE(p.count(RR_HEARTBEAT) + p.count(RR_DELTA) + p.count(RR_CALD) >= 86400 / 300);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_then_quiet);
+  RUN_TEST(test_delta_both_ways_against_sent_value);
+  RUN_TEST(test_cald_change);
+  RUN_TEST(test_pull_and_heartbeat);
+  RUN_TEST(test_invalid_temp_only_pulls);
+  RUN_TEST(test_failure_waits_retry_and_keeps_pending);
+  RUN_TEST(test_force);
+  RUN_TEST(test_timers_across_millis_wrap);
+  RUN_TEST(test_day_request_count);
+  return UNITY_END();
+}
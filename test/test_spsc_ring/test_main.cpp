@@ -0,0 +1,142 @@
+// Host tests for include/spsc_ring.h with a real producer thread (pio test -e native)
+// The producer stands in for the ESP-NOW receive callback, the consumer for the loop() drain.
+
+#include <unity.h>
+#include <thread>
+#include <string.h>
+#include "spsc_ring.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct Frame // shaped like the RX slot in main.cpp: raw bytes + timestamp
+{
+  uint32_t seq;
+  uint32_t atMs;
+  uint8_t len;
+  uint8_t data[23];
+};
+
+static Frame make(uint32_t seq)
+{
+  Frame f;
+  f.seq = seq;
+  f.atMs = seq * 7u;
+  f.len = (uint8_t)(seq % sizeof(f.data) + 1);
+  for (uint8_t i = 0; i < sizeof(f.data); ++i)
+    f.data[i] = (uint8_t)(seq + i);
+  return f;
+}
+
+static bool intact(const Frame &f)
+{
+  const Frame w = make(f.seq);
+  return f.atMs == w.atMs && f.len == w.len && memcmp(f.data, w.data, sizeof(f.data)) == 0;
+}
+
+static void test_single_thread_basics()
+{
+  SpscRing<Frame, 4> r;
+  Frame f;
+  TEST_ASSERT_FALSE(r.pop(f));
+  for (uint32_t i = 0; i < 4; ++i)
+    TEST_ASSERT_TRUE(r.push(make(i)));
+  TEST_ASSERT_FALSE(r.push(make(4)));
+  TEST_ASSERT_EQUAL(1, r.overflows());
+  TEST_ASSERT_EQUAL(4, r.highWater());
+  TEST_ASSERT_EQUAL(4, r.size());
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    TEST_ASSERT_TRUE(r.pop(f));
+    TEST_ASSERT_EQUAL(i, f.seq);
+  }
+  TEST_ASSERT_EQUAL(0, r.size());
+}
+
+static void test_index_wrap()
+{
+  // 16-bit head/tail wrap several times over
+  SpscRing<Frame, 8> r;
+  Frame f;
+  for (uint32_t i = 0; i < 200000; ++i)
+  {
+    TEST_ASSERT_TRUE(r.push(make(i)));
+    TEST_ASSERT_TRUE(r.pop(f));
+    TEST_ASSERT_EQUAL(i, f.seq);
+  }
+  TEST_ASSERT_EQUAL(1, r.highWater());
+}
+
+// Producer never drops (spins when full): every frame arrives once, in order, intact
+static void test_threaded_lossless()
+{
+  static SpscRing<Frame, 16> r;
+  const uint32_t total = 200000;
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < total; ++i)
+      while (!r.push(make(i)))
+        std::this_thread::yield();
+  });
+  uint32_t next = 0, bad = 0;
+  Frame f;
+  while (next < total)
+  {
+    if (!r.pop(f))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    if (f.seq != next || !intact(f))
+      bad++;
+    next++;
+  }
+  producer.join();
+  TEST_ASSERT_EQUAL(0, bad);
+  TEST_ASSERT_EQUAL(total, next);
+  TEST_ASSERT_TRUE(r.highWater() <= 16);
+}
+
+// Producer drops when full, like the callback: what arrives is ordered and intact, and
+// delivered + overflows accounts for every frame
+static void test_threaded_overflow_accounting()
+{
+  static SpscRing<Frame, 8> r;
+  const uint32_t total = 200000;
+  std::atomic<bool> done{false};
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < total; ++i)
+      r.push(make(i));
+    done.store(true, std::memory_order_release);
+  });
+  uint32_t got = 0, bad = 0;
+  int64_t last = -1;
+  Frame f;
+  for (;;)
+  {
+    const bool finished = done.load(std::memory_order_acquire);
+    while (r.pop(f))
+    {
+      if ((int64_t)f.seq <= last || !intact(f))
+        bad++;
+      last = f.seq;
+      got++;
+    }
+    if (finished)
+      break;
+    std::this_thread::yield();
+  }
+  producer.join();
+  TEST_ASSERT_EQUAL(0, bad);
+  TEST_ASSERT_EQUAL(total, got + r.overflows());
+  TEST_ASSERT_TRUE(r.highWater() <= 8);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_single_thread_basics);
+  RUN_TEST(test_index_wrap);
+  RUN_TEST(test_threaded_lossless);
+  RUN_TEST(test_threaded_overflow_accounting);
+  return UNITY_END();
+}
@@ -0,0 +1,145 @@
+// Noisy-trace replay for include/temp_filter.h (pio test -e native)
+// Traces are generated deterministically: a true room curve, DS18B20 1/16 °C quantisation,
+// +/- 1 LSB noise, and injected glitches (85.00 °C power-on reads, +/- several °C bad reads).
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "temp_filter.h"
+#include "heat_control.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct Rng
+{
+  uint32_t s;
+  uint32_t next()
+  {
+    s = s * 1103515245u + 12345u;
+    return s >> 16;
+  }
+};
+
+// True temperature (0.01 °C) at second t: triangle 18.70..19.30 °C, 40 min period (below the
+// 19.80 °C cutoff, so the 19.00 °C hysteresis decides)
+static int32_t truthCd(uint32_t t)
+{
+  const int32_t phase = (int32_t)(t % 2400);
+  const int32_t tri = phase < 1200 ? phase : 2400 - phase; // 0..1200
+  return 1870 + tri * 60 / 1200;
+}
+
+struct Replay
+{
+  uint32_t spikes = 0;
+  uint32_t maxErrCd = 0;     // |filtered - truth| after priming
+  uint32_t rawToggles = 0;   // hysteresis decisions flipping on the raw stream
+  uint32_t filtToggles = 0;  // ... and on the filtered stream
+  uint32_t truthToggles = 0; // ... and on the noiseless truth
+};
+
+static Replay replay(TempFilter<5> &f, uint32_t seconds, uint16_t spikePermille, uint32_t seed)
+{
+  Replay r;
+  Rng rng = {seed};
+  uint8_t hRaw = 0, hFilt = 0, hTruth = 0;
+  for (uint32_t t = 0; t < seconds; ++t)
+  {
+    const int32_t truth = truthCd(t);
+    int32_t raw16 = (truth * 16 + 50) / 100 + (int32_t)(rng.next() % 3) - 1;
+    cdeg_t x = cdeg_from_raw16((int16_t)raw16);
+    if (rng.next() % 1000 < spikePermille)
+    {
+      r.spikes++;
+      x = (rng.next() & 1) ? 8500 : (cdeg_t)(truth + ((rng.next() & 1) ? 500 : -700));
+    }
+    const cdeg_t y = f.push(x, TEMP_FILTER_DEFAULTS);
+    if (t >= 10)
+    {
+      const uint32_t err = (uint32_t)abs(y - truth);
+      if (err > r.maxErrCd)
+        r.maxErrCd = err;
+    }
+    const uint8_t a = apply_hysteresis(x, 1900, hRaw);
+    const uint8_t b = apply_hysteresis(y, 1900, hFilt);
+    const uint8_t c = apply_hysteresis((cdeg_t)truth, 1900, hTruth);
+    r.rawToggles += a != hRaw;
+    r.filtToggles += b != hFilt;
+    r.truthToggles += c != hTruth;
+    hRaw = a;
+    hFilt = b;
+    hTruth = c;
+  }
+  return r;
+}
+
+static void test_power_on_value_never_first()
+{
+  TempFilter<5> f;
+  TEST_ASSERT_EQUAL(CDEG_INVALID, f.push(8500, TEMP_FILTER_DEFAULTS));
+  TEST_ASSERT_EQUAL(2000, f.push(2000, TEMP_FILTER_DEFAULTS));
+  TEST_ASSERT_EQUAL(2000, f.push(8500, TEMP_FILTER_DEFAULTS));
+  TEST_ASSERT_EQUAL(2, f.rejected());
+}
+
+static void test_noisy_trace_with_glitches()
+{
+  TempFilter<5> f;
+  const Replay r = replay(f, 6 * 3600, 20, 42); // 6 h, 2 % glitches
+  char msg[160];
+  snprintf(msg, sizeof(msg),
+           "6 h, %u glitches: rejected %u, max err %u cd, toggles raw %u / filtered %u / truth %u, lag max %u cd",
+           r.spikes, f.rejected(), r.maxErrCd, r.rawToggles, r.filtToggles, r.truthToggles, f.lagMaxCd());
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(f.rejected() >= r.spikes * 9 / 10); // isolated glitches are all dropped
+  TEST_ASSERT_EQUAL(0, f.restarts());                   // and never mistaken for a step
+  TEST_ASSERT_TRUE(r.maxErrCd <= 20);                   // output stays within 0.2 °C of the truth
+  TEST_ASSERT_TRUE(r.filtToggles <= r.truthToggles + 2); // no spurious heater flips
+  TEST_ASSERT_TRUE(r.rawToggles > r.filtToggles * 5);
+}
+
+static void test_clean_trace_untouched()
+{
+  TempFilter<5> f;
+  const Replay r = replay(f, 3600, 0, 7);
+  TEST_ASSERT_EQUAL(0, f.rejected());
+  TEST_ASSERT_TRUE(r.maxErrCd <= 15);
+}
+
+// A genuine step (sensor moved, radiator valve opened) is taken after N suspect samples
+static void test_real_step_accepted()
+{
+  TempFilter<5> f;
+  for (uint8_t i = 0; i < 20; ++i)
+    f.push(2000, TEMP_FILTER_DEFAULTS);
+  uint8_t n = 0;
+  while (f.push(2400, TEMP_FILTER_DEFAULTS) != 2400 && n < 40)
+    n++;
+  TEST_ASSERT_EQUAL(1, f.restarts());
+  TEST_ASSERT_TRUE(n <= 5 + 1);
+}
+
+static void test_lag_samples()
+{
+  TEST_ASSERT_EQUAL(2 + 3, TempFilter<5>::lagSamples(TEMP_FILTER_DEFAULTS));
+  const TempFilterConfig medOnly = {150, 0};
+  TEST_ASSERT_EQUAL(1, TempFilter<3>::lagSamples(medOnly));
+  // Median only: a ramp of 1 cd/sample lags by (N-1)/2 samples
+  TempFilter<3> f;
+  cdeg_t y = 0;
+  for (int16_t i = 0; i < 50; ++i)
+    y = f.push((cdeg_t)(2000 + i), medOnly);
+  TEST_ASSERT_EQUAL(2049 - 1, y);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_power_on_value_never_first);
+  RUN_TEST(test_noisy_trace_with_glitches);
+  RUN_TEST(test_clean_trace_untouched);
+  RUN_TEST(test_real_step_accepted);
+  RUN_TEST(test_lag_samples);
+  return UNITY_END();
+}
@@ -0,0 +1,134 @@
+// Host tests for include/thermal_sim.h: plant sanity, sensor path, and a 30-day accelerated
+// run of both controllers through SimControlLoop with wall-clock timing (pio test -e native)
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "thermal_sim.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_unheated_room_decays_towards_outdoor()
+{
+  PlantConfig pc = PLANT_DEFAULTS;
+  pc.outdoorSwingCd = 0;
+  pc.startCd = 2000;
+  ThermalPlant p(pc);
+  cdeg_t prev = p.room();
+  for (uint32_t t = 0; t < 48 * 3600; t += 60)
+  {
+    const cdeg_t r = p.step(false, 60, t);
+    TEST_ASSERT_TRUE(r <= prev);
+    prev = r;
+  }
+  TEST_ASSERT_INT_WITHIN(100, pc.outdoorMeanCd, prev); // 48 h = ~7 time constants
+}
+
+static void test_heated_room_settles_above_outdoor()
+{
+  PlantConfig pc = PLANT_DEFAULTS;
+  pc.outdoorSwingCd = 0;
+  pc.radiatorLagS = 0;
+  ThermalPlant p(pc);
+  cdeg_t r = p.room();
+  for (uint32_t t = 0; t < 72 * 3600; t += 60)
+    r = p.step(true, 60, t);
+  // Equilibrium: heat = loss x (T - Tout) -> 4 °C/h / 0.15 /h = 26.7 °C above outdoor
+  TEST_ASSERT_INT_WITHIN(50, pc.outdoorMeanCd + 2667, r);
+}
+
+static void test_radiator_lag_delays_heat()
+{
+  PlantConfig fast = PLANT_DEFAULTS;
+  fast.radiatorLagS = 0;
+  ThermalPlant a(fast), b(PLANT_DEFAULTS);
+  cdeg_t ra = 0, rb = 0;
+  for (uint32_t t = 0; t < 600; t += 30)
+  {
+    ra = a.step(true, 30, t);
+    rb = b.step(true, 30, t);
+  }
+  TEST_ASSERT_TRUE(ra > rb);
+}
+
+static void test_outdoor_wave()
+{
+  ThermalPlant p(PLANT_DEFAULTS);
+  TEST_ASSERT_EQUAL(100 * 10000, p.outdoorU(4 * 3600));  // 04:00: mean - swing
+  TEST_ASSERT_EQUAL(900 * 10000, p.outdoorU(16 * 3600)); // 16:00: mean + swing
+}
+
+static void test_sensor_is_quantised_and_deterministic()
+{
+  PlantConfig pc = PLANT_DEFAULTS;
+  pc.noiseRaw16 = 0;
+  pc.startCd = 1903;
+  ThermalPlant p(pc);
+  TEST_ASSERT_EQUAL(1900, p.sensor()); // 19.03 °C reads as 304/16 = 19.00 °C
+  PlantConfig noisy = PLANT_DEFAULTS;
+  noisy.noiseRaw16 = 2;
+  ThermalPlant x(noisy), y(noisy);
+  for (int i = 0; i < 100; ++i)
+  {
+    const cdeg_t s = x.sensor();
+    TEST_ASSERT_EQUAL(s, y.sensor());
+    TEST_ASSERT_INT_WITHIN(13, noisy.startCd, s); // +/- 2 steps of 6.25 + quantisation
+  }
+}
+
+static void test_sleep_setpoint_holds_heater_off()
+{
+  const SimSchedule sleep = {1900, 1000, 0, 0}; // never day: always the 10 °C sleep setpoint
+  uint32_t calls = 0;
+  const SimReport r = sim_run(PLANT_DEFAULTS, sleep, 1, 60,
+                              [&](cdeg_t, cdeg_t, uint32_t)
+                              {
+                                calls++;
+                                return true;
+                              },
+                              [] {});
+  TEST_ASSERT_EQUAL(0, calls);
+  TEST_ASSERT_EQUAL(0, r.onPermille);
+  TEST_ASSERT_EQUAL(0, r.cycles);
+}
+
+// 30 simulated days, 30 s steps (86400 control decisions), both controllers
+static void bench(bool tpi)
+{
+  SimControlLoop<5> loop(tpi, TEMP_FILTER_DEFAULTS, TPI_DEFAULTS, HEATER_DEFAULTS);
+  uint32_t hours = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  const SimReport r = sim_run(PLANT_DEFAULTS, SIM_SCHEDULE_DEFAULTS, 30, 30,
+                              [&](cdeg_t s, cdeg_t sp, uint32_t now) { return loop.step(s, sp, now); },
+                              [&] { hours++; });
+  const auto t1 = std::chrono::steady_clock::now();
+  const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  char msg[200];
+  snprintf(msg, sizeof(msg),
+           "%-10s 30 days in %.1f ms (%.0f ns/step): err %.2f C, cold %.1f %%, on %.1f %%, %.2f cycles/h",
+           tpi ? "tpi" : "hysteresis", ms, ms * 1e6 / r.steps, r.comfortAbsErrCd / 100.0, r.coldPermille / 10.0,
+           r.onPermille / 10.0, r.cyclesPerHourX100 / 100.0);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(30UL * 86400 / 30, r.steps);
+  TEST_ASSERT_EQUAL(30 * 24, hours);
+  TEST_ASSERT_TRUE(r.comfortAbsErrCd < 80);
+  TEST_ASSERT_TRUE(ms < 1000); // a month of operation in well under a second on a host
+}
+
+static void test_bench_hysteresis_30_days() { bench(false); }
+static void test_bench_tpi_30_days() { bench(true); }
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_unheated_room_decays_towards_outdoor);
+  RUN_TEST(test_heated_room_settles_above_outdoor);
+  RUN_TEST(test_radiator_lag_delays_heat);
+  RUN_TEST(test_outdoor_wave);
+  RUN_TEST(test_sensor_is_quantised_and_deterministic);
+  RUN_TEST(test_sleep_setpoint_holds_heater_off);
+  RUN_TEST(test_bench_hysteresis_30_days);
+  RUN_TEST(test_bench_tpi_30_days);
+  return UNITY_END();
+}
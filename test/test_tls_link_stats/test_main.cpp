@@ -0,0 +1,156 @@
+// Host tests for include/tls_link_stats.h, and the keep-alive / resumption rates to expect from
+// the report policy's request pattern against typical server timeouts (pio test -e native)
+
+#include <unity.h>
+#include <stdio.h>
+#include "report_policy.h"
+#include "tls_link_stats.h"
+
+void setUp() {}
+void tearDown() {}
+
+static TlsSessionId sid(uint8_t len, uint8_t seed)
+{
+  TlsSessionId s = {};
+  s.len = len;
+  for (uint8_t i = 0; i < len; ++i)
+    s.id[i] = (uint8_t)(seed + i);
+  return s;
+}
+
+static void test_classification()
+{
+  const TlsSessionId none = {}, a = sid(32, 1), b = sid(32, 2);
+  TlsLinkStats s;
+  s.record(false, true, none, a, true); // first connection: full handshake
+  s.record(true, true, a, a, true);     // kept-alive: no handshake at all
+  s.record(false, true, a, a, true);    // server echoed the cached ID: resumed
+  s.record(false, true, a, b, true);    // new ID: full handshake
+  s.record(false, true, none, none, true); // server without a session cache: never resumed
+  TEST_ASSERT_EQUAL(5, s.requests());
+  TEST_ASSERT_EQUAL(1, s.reused());
+  TEST_ASSERT_EQUAL(4, s.handshakes());
+  TEST_ASSERT_EQUAL(1, s.resumed());
+  TEST_ASSERT_EQUAL(3, s.fullHandshakes());
+  TEST_ASSERT_EQUAL(250, s.resumePermille());
+  TEST_ASSERT_EQUAL(200, s.reusePermille());
+  TEST_ASSERT_EQUAL(0, s.fails());
+}
+
+static void test_failures()
+{
+  const TlsSessionId a = sid(32, 1);
+  TlsLinkStats s;
+  s.record(false, false, a, a, false); // connect/handshake failed: no handshake counted
+  s.record(false, true, a, a, false);  // resumed, then a 500
+  s.record(true, true, a, a, false);   // kept-alive socket, bad status
+  TEST_ASSERT_EQUAL(3, s.requests());
+  TEST_ASSERT_EQUAL(3, s.fails());
+  TEST_ASSERT_EQUAL(1, s.handshakes());
+  TEST_ASSERT_EQUAL(1, s.resumed());
+  TEST_ASSERT_EQUAL(0, s.reused());
+}
+
+static void test_same_session()
+{
+  TEST_ASSERT_FALSE(tls_same_session(sid(0, 0), sid(0, 0))); // no ID: nothing to resume
+  TEST_ASSERT_TRUE(tls_same_session(sid(32, 7), sid(32, 7)));
+  TEST_ASSERT_FALSE(tls_same_session(sid(32, 7), sid(16, 7)));
+  TEST_ASSERT_FALSE(tls_same_session(sid(32, 7), sid(32, 8)));
+}
+
+// --- expected rates: one simulated day of the report task against a server model ---
+// Server: closes an idle keep-alive socket after keepAliveMs, or after maxRequests on it;
+// resumes a cached session ID for cacheMs after the full handshake that created it (OpenSSL,
+// Apache shmcb: the timeout runs from creation); cacheMs = 0: no session cache.
+struct ServerModel
+{
+  uint32_t keepAliveMs;
+  uint32_t maxRequests;
+  uint32_t cacheMs;
+};
+
+struct Rates
+{
+  uint32_t requests;
+  uint16_t reusePm;
+  uint16_t resumePm;
+  uint32_t fullHandshakes;
+};
+
+static Rates simulate_day(const ServerModel &srv)
+{
+  ReportPolicy pol;
+  TlsLinkStats st;
+  TlsSessionId client = {}, server = {};
+  uint32_t sessionAt = 0, lastEnd = 0, onSocket = 0;
+  uint8_t nextId = 1;
+  bool open = false;
+  for (uint32_t now = 1; now < 86400000UL; now += 1500) // report task cadence
+  {
+    // Slow room swing plus the relay toggling every 20 min
+    const uint32_t s = now / 1000;
+    const int32_t tri = (int32_t)(s % 3600) < 1800 ? (int32_t)(s % 3600) : 3600 - (int32_t)(s % 3600);
+    const cdeg_t temp = (cdeg_t)(1880 + tri * 40 / 1800);
+    const bool cald = (s / 1200) % 2 == 0;
+    const uint8_t why = pol.due(REPORT_DEFAULTS, temp, cald, now);
+    if (why == RR_NONE)
+      continue;
+
+    const bool kept = open && now - lastEnd < srv.keepAliveMs && onSocket < srv.maxRequests;
+    const TlsSessionId before = client;
+    if (!kept)
+    {
+      onSocket = 0;
+      if (!(srv.cacheMs && tls_same_session(client, server) && now - sessionAt < srv.cacheMs))
+      {
+        server = srv.cacheMs ? sid(32, nextId++) : sid(0, 0); // full handshake, new ID (or none)
+        sessionAt = now;
+        client = server;
+      }
+    }
+    st.record(kept, true, before, client, true);
+    onSocket++;
+    open = true;
+    const uint32_t took = kept ? 150 : 600; // request time on the device, roughly
+    lastEnd = now + took;
+    pol.done(why, true, temp, cald, lastEnd);
+  }
+  return {st.requests(), st.reusePermille(), st.resumePermille(), st.fullHandshakes()};
+}
+
+static Rates report(const char *name, const ServerModel &srv)
+{
+  const Rates r = simulate_day(srv);
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%-28s %u requests/day, kept-alive %.1f %%, resumed %.1f %% of handshakes, %u full",
+           name, r.requests, r.reusePm / 10.0, r.resumePm / 10.0, r.fullHandshakes);
+  TEST_MESSAGE(msg);
+  return r;
+}
+
+static void test_expected_rates_with_30s_pull()
+{
+  // Apache / LiteSpeed: 5 s keep-alive, 300 s session cache
+  const Rates apache = report("keep-alive 5 s, cache 5 min", {5000, 100, 300000});
+  TEST_ASSERT_TRUE(apache.reusePm < 50);    // the 30 s pull outlives the socket
+  TEST_ASSERT_TRUE(apache.resumePm > 900);  // ...but nearly every reconnect resumes
+  TEST_ASSERT_TRUE(apache.fullHandshakes <= 24 * 12 + 1); // one per cache lifetime
+  // nginx: 75 s keep-alive, 1000 requests per connection, 5 min session cache
+  const Rates nginx = report("keep-alive 75 s, cache 5 min", {75000, 1000, 300000});
+  TEST_ASSERT_TRUE(nginx.reusePm > 990);
+  // No session cache on the server: every reconnect is a full handshake
+  const Rates bare = report("keep-alive 5 s, no cache", {5000, 100, 0});
+  TEST_ASSERT_EQUAL(0, bare.resumePm);
+  TEST_ASSERT_TRUE(bare.fullHandshakes > bare.requests * 9 / 10);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_classification);
+  RUN_TEST(test_failures);
+  RUN_TEST(test_same_session);
+  RUN_TEST(test_expected_rates_with_30s_pull);
+  return UNITY_END();
+}
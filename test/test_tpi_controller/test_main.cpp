@@ -0,0 +1,151 @@
+// Host tests for include/tpi_controller.h and a hysteresis vs TPI comparison on the simulated
+// room of include/thermal_sim.h (pio test -e native)
+
+#include <unity.h>
+#include <stdio.h>
+#include "thermal_sim.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const TpiConfig P_ONLY = {600000UL, 500, 0, 60000UL}; // 50 % duty per °C, no integral
+
+static void test_p_only_duty_and_window()
+{
+  TpiController c;
+  TEST_ASSERT_TRUE(c.update(1800, 1900, 1, P_ONLY)); // 1 °C below: 50 %
+  TEST_ASSERT_EQUAL(500, c.dutyPermille());
+  TEST_ASSERT_EQUAL(300000, c.onMs());
+  TEST_ASSERT_TRUE(c.update(1800, 1900, 299000, P_ONLY));
+  TEST_ASSERT_FALSE(c.update(1800, 1900, 301000, P_ONLY));
+  TEST_ASSERT_TRUE(c.update(1800, 1900, 600001, P_ONLY)); // next cycle
+  TEST_ASSERT_EQUAL(2, c.cycles());
+}
+
+static void test_min_pulse_snaps_windows()
+{
+  TpiController c;
+  c.update(1895, 1900, 1, P_ONLY); // 2.5 % = 15 s < 60 s: no pulse at all
+  TEST_ASSERT_EQUAL(0, c.onMs());
+  TpiController d;
+  d.update(1705, 1900, 1, P_ONLY); // 97.5 %: 15 s OFF window merged into a full cycle
+  TEST_ASSERT_EQUAL(600000, d.onMs());
+}
+
+static void test_started_pulse_shrinks_no_lower_than_min()
+{
+  TpiController c;
+  TEST_ASSERT_TRUE(c.update(1800, 1900, 1, P_ONLY)); // 300 s window
+  TEST_ASSERT_TRUE(c.update(1950, 1900, 10001, P_ONLY)); // overshoot: duty 0
+  TEST_ASSERT_EQUAL(0, c.dutyPermille());
+  TEST_ASSERT_EQUAL(60000, c.onMs()); // runs its 60 s minimum, no less
+  TEST_ASSERT_FALSE(c.update(1950, 1900, 60002, P_ONLY));
+}
+
+static void test_shrink_leaves_no_short_off_rest()
+{
+  TpiController c;
+  TEST_ASSERT_TRUE(c.update(1705, 1900, 1, P_ONLY)); // full 600 s cycle
+  TEST_ASSERT_TRUE(c.update(1705, 1900, 560001, P_ONLY));
+  TEST_ASSERT_TRUE(c.update(1950, 1900, 560002, P_ONLY)); // 40 s OFF rest < 60 s: heat to the end
+  TEST_ASSERT_EQUAL(600000, c.onMs());
+  TpiController d;
+  d.update(1705, 1900, 1, P_ONLY);
+  TEST_ASSERT_FALSE(d.update(1950, 1900, 500001, P_ONLY)); // 100 s OFF rest: ends now
+  TEST_ASSERT_EQUAL(500000, d.onMs());
+}
+
+static void test_integral_anti_windup()
+{
+  const TpiConfig pi = {600000UL, 500, 1800000UL, 60000UL};
+  TpiController c;
+  uint32_t t = 1;
+  for (uint32_t i = 0; i < 6 * 360; ++i, t += 10000) // 6 h 3 °C below: saturated at 100 %
+    c.update(1600, 1900, t, pi);
+  TEST_ASSERT_EQUAL(1000, c.dutyPermille());
+  TEST_ASSERT_TRUE(c.iTermPermille() <= 1000);
+  // Setpoint reached: a wound-up integral would keep the heater at 100 % for a long time
+  for (uint32_t i = 0; i < 6; ++i, t += 10000)
+    c.update(1900, 1900, t, pi);
+  TEST_ASSERT_TRUE(c.dutyPermille() < 1000);
+  TEST_ASSERT_TRUE(c.iTermPermille() >= 0);
+}
+
+static void test_effective_min_pulse()
+{
+  const TpiConfig e = tpi_effective(TPI_DEFAULTS, HEATER_DEFAULTS.minOnMs, HEATER_DEFAULTS.minOffMs);
+  TEST_ASSERT_EQUAL(180000, e.minPulseMs);
+  TEST_ASSERT_EQUAL(TPI_DEFAULTS.cycleMs, e.cycleMs);
+  const TpiConfig f = tpi_effective(TPI_DEFAULTS, 0, 0);
+  TEST_ASSERT_EQUAL(TPI_DEFAULTS.minPulseMs, f.minPulseMs);
+}
+
+// --- comparison on the simulated room: 7 days, 30 s steps, defaults everywhere ---
+struct Run
+{
+  SimReport r;
+  uint32_t mismatch;
+  uint32_t want;
+  uint32_t delivered;
+};
+
+static Run simulate(bool tpi, const TpiConfig &tc)
+{
+  SimControlLoop<5> loop(tpi, TEMP_FILTER_DEFAULTS, tc, HEATER_DEFAULTS);
+  Run out;
+  out.r = sim_run(PLANT_DEFAULTS, SIM_SCHEDULE_DEFAULTS, 7, 30,
+                  [&](cdeg_t s, cdeg_t sp, uint32_t now) { return loop.step(s, sp, now); }, [] {});
+  out.mismatch = loop.mismatchSteps;
+  out.want = loop.wantSteps;
+  out.delivered = loop.deliveredSteps;
+  char msg[200];
+  snprintf(msg, sizeof(msg),
+           "%-10s err %.2f C, cold %.1f %%, on %.1f %%, %.2f cycles/h, overshoot %.2f C, output changed %u/%u steps",
+           tpi ? "tpi" : "hysteresis", out.r.comfortAbsErrCd / 100.0, out.r.coldPermille / 10.0,
+           out.r.onPermille / 10.0, out.r.cyclesPerHourX100 / 100.0, out.r.maxOvershootCd / 100.0, out.mismatch,
+           out.r.steps);
+  TEST_MESSAGE(msg);
+  return out;
+}
+
+static void test_compare_controllers_on_simulated_room()
+{
+  const Run h = simulate(false, TPI_DEFAULTS);
+  const Run t = simulate(true, TPI_DEFAULTS);
+  // Both hold the comfort setpoint, within the 3 min minimum ON/OFF times
+  TEST_ASSERT_TRUE(h.r.comfortAbsErrCd < 80); // mostly the 06:00 warm-up from the setback
+  TEST_ASSERT_TRUE(t.r.comfortAbsErrCd <= h.r.comfortAbsErrCd);
+  TEST_ASSERT_TRUE(h.r.cyclesPerHourX100 <= 1000); // <= 10/h: 3 min ON + 3 min OFF at best
+  TEST_ASSERT_TRUE(t.r.cyclesPerHourX100 <= 600);  // TPI: at most one pulse per 10 min cycle
+  TEST_ASSERT_TRUE(t.r.maxOvershootCd <= h.r.maxOvershootCd + 20);
+  // With the TPI windows raised to the output's minimum times, what TPI computes is what
+  // the relay gets (max ON cooldowns aside)
+  TEST_ASSERT_EQUAL(0, t.mismatch);
+}
+
+// Raw 60 s TPI windows behind 180 s output minimums: pulses get stretched/deferred
+static void test_short_tpi_pulses_would_be_distorted()
+{
+  SimControlLoop<5> loop(true, TEMP_FILTER_DEFAULTS, TPI_DEFAULTS, HEATER_DEFAULTS);
+  loop.tpiCfg = TPI_DEFAULTS; // bypass tpi_effective
+  sim_run(PLANT_DEFAULTS, SIM_SCHEDULE_DEFAULTS, 7, 30,
+          [&](cdeg_t s, cdeg_t sp, uint32_t now) { return loop.step(s, sp, now); }, [] {});
+  char msg[96];
+  snprintf(msg, sizeof(msg), "tpi with 60 s windows: output changed %u steps", loop.mismatchSteps);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(loop.mismatchSteps > 0);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_p_only_duty_and_window);
+  RUN_TEST(test_min_pulse_snaps_windows);
+  RUN_TEST(test_started_pulse_shrinks_no_lower_than_min);
+  RUN_TEST(test_shrink_leaves_no_short_off_rest);
+  RUN_TEST(test_integral_anti_windup);
+  RUN_TEST(test_effective_min_pulse);
+  RUN_TEST(test_compare_controllers_on_simulated_room);
+  RUN_TEST(test_short_tpi_pulses_would_be_distorted);
+  return UNITY_END();
+}
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+# tools/cesana_standin.py — local HTTPS stand-in for get_setpoint.php
+# - Serves the same JSON as pagina/get_setpoint.php (MANUAL mode, fixed setpoint), over TLS
+#   with HTTP/1.1 keep-alive, so the thermostat's long-lived client can be watched off the
+#   real server
+# - Logs every connection as a full or resumed handshake, every request with its index on the
+#   socket, and why the socket closed; prints totals on Ctrl-C
+# - --keepalive and --max-requests mimic the real server's limits (Apache/LiteSpeed 5 s,
+#   nginx 75 s / 1000), to see which one the 30 s pull actually hits
+#
+# Build the firmware with -DCESANA_HOST=\"<this machine's IP>\" -DCESANA_PORT=8443, then:
+#   python3 tools/cesana_standin.py --keepalive 75
+# A self-signed certificate is created next to this script on first run (needs the openssl
+# CLI); the device does not check it.
+
+import argparse
+import json
+import os
+import socket
+import ssl
+import subprocess
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+stats = {"connections": 0, "full": 0, "resumed": 0, "requests": 0, "keptAlive": 0}
+lock = threading.Lock()
+state = {"actualTemp": None, "cald": 0}
+
+
+def log(msg):
+    print(time.strftime("%H:%M:%S"), msg, flush=True)
+
+
+def ensure_cert(cert, key):
+    if os.path.exists(cert) and os.path.exists(key):
+        return
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "3650",
+                    "-subj", "/CN=cesana-standin", "-keyout", key, "-out", cert],
+                   check=True, capture_output=True)
+    log(f"created self-signed certificate {cert}")
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # keep-alive unless the client or the limits close it
+
+    def setup(self):
+        self.timeout = self.server.keepalive  # idle limit between requests on one socket
+        super().setup()
+        self.conn_requests = 0
+        with lock:
+            stats["connections"] += 1
+            self.conn_id = stats["connections"]
+
+    def handle(self):
+        tls = self.request
+        try:
+            tls.do_handshake()
+        except (ssl.SSLError, OSError) as e:
+            log(f"#{self.conn_id} handshake failed: {e}")
+            return
+        resumed = tls.session_reused
+        sid = tls.session.id.hex()[:16] if tls.session else "-"
+        with lock:
+            stats["resumed" if resumed else "full"] += 1
+        log(f"#{self.conn_id} {self.client_address[0]} {tls.version()} "
+            f"{'resumed' if resumed else 'full handshake'} (session {sid}...)")
+        try:
+            super().handle()
+        except (socket.timeout, ConnectionError, ssl.SSLError):
+            pass
+        try:
+            tls.settimeout(1)
+            tls.unwrap()  # close_notify: OpenSSL drops a session from its cache after an unclean close
+        except (OSError, ValueError):
+            pass
+        why = "limit" if self.conn_requests >= self.server.max_requests else "idle or client close"
+        log(f"#{self.conn_id} closed after {self.conn_requests} request(s) ({why})")
+
+    def do_GET(self):
+        self.conn_requests += 1
+        with lock:
+            stats["requests"] += 1
+            if self.conn_requests > 1:
+                stats["keptAlive"] += 1
+        url = urlparse(self.path)
+        q = parse_qs(url.query)
+        log(f"#{self.conn_id} request {self.conn_requests} on this socket: GET {self.path}")
+        if url.path != "/get_setpoint.php":
+            self.reply(404, {"ok": False, "error": "not found"})
+            return
+        if "schedule" in q:
+            self.reply(200, {"ok": False, "error": "no schedule in the stand-in"})
+            return
+        if "temp" in q:
+            state["actualTemp"] = round(float(q["temp"][0]), 1)
+        if "cald" in q:
+            state["cald"] = 1 if q["cald"][0] == "1" else 0
+        now = time.localtime()
+        t = state["actualTemp"]
+        self.reply(200, {
+            "ok": True,
+            "mode": "MANUAL",
+            "setpoint": self.server.setpoint,
+            "next_setpoint": None,
+            "next_change_s": None,
+            "actualTemp": t,
+            "actualTemp_str": f"{t:.1f}" if t is not None else None,
+            "cald": state["cald"],
+            "date": time.strftime("%Y-%m-%d", now),
+            "time": time.strftime("%H:%M:%S", now),
+            "timezone": time.strftime("%Z", now),
+        })
+
+    def reply(self, code, obj):
+        body = json.dumps(obj).encode()
+        close = self.conn_requests >= self.server.max_requests
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json; charset=utf-8")
+        self.send_header("Content-Length", str(len(body)))
+        if close:
+            self.send_header("Connection", "close")
+            self.close_connection = True
+        else:
+            self.send_header("Keep-Alive", f"timeout={int(self.server.keepalive)}, max={self.server.max_requests}")
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, fmt, *args):
+        pass  # one line per request from do_GET() is enough
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Local HTTPS stand-in for get_setpoint.php")
+    ap.add_argument("--port", type=int, default=8443)
+    ap.add_argument("--keepalive", type=float, default=5.0, help="idle seconds before closing a socket")
+    ap.add_argument("--max-requests", type=int, default=100, help="requests per socket")
+    ap.add_argument("--setpoint", type=float, default=19.0)
+    ap.add_argument("--cert", default=os.path.join(HERE, "standin_cert.pem"))
+    ap.add_argument("--key", default=os.path.join(HERE, "standin_key.pem"))
+    a = ap.parse_args()
+
+    ensure_cert(a.cert, a.key)
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    ctx.load_cert_chain(a.cert, a.key)
+    ctx.options |= ssl.OP_NO_TICKET  # session-ID resumption only, like BearSSL
+
+    srv = ThreadingHTTPServer(("", a.port), Handler)
+    srv.socket = ctx.wrap_socket(srv.socket, server_side=True, do_handshake_on_connect=False)
+    srv.keepalive = a.keepalive
+    srv.max_requests = a.max_requests
+    srv.setpoint = a.setpoint
+    log(f"listening on :{a.port}, keep-alive {a.keepalive:g} s / {a.max_requests} requests")
+    try:
+        srv.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    s = stats
+    hs = s["full"] + s["resumed"]
+    log(f"{s['requests']} requests, {s['keptAlive']} kept-alive, {hs} handshakes "
+        f"({s['resumed']} resumed, {100.0 * s['resumed'] / hs if hs else 0:.0f} %)")
+
+
+if __name__ == "__main__":
+    main()